@@ -1,239 +1,3189 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
 #include <vector>
+#include <functional>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <condition_variable>
+#include <semaphore>
+#include <barrier>
+#include <memory>
 #include <atomic>
 #include <chrono>
 #include <random>
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <optional>
+#include <coroutine>
+#include <deque>
+#include <filesystem>
+#include <pthread.h>
+#include <sched.h>
+#include <array>
+#include <limits>
+#include <cstring>
+#include <sys/utsname.h>
+#include "async_log.h"
+#include "fast_random.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
+// Сообщение потока для журнала: номер потока и сгенерированный символ
+struct CharMessage {
+    int thread; // Номер потока, начиная с 1
+    char symbol;
+};
+
+// Форматирование сообщений выполняется фоновым потоком журнала, а не в критической секции
+void formatRandomChar(string& out, const CharMessage& message) {
+    out += "Поток ";
+    out += to_string(message.thread);
+    out += ": Случайный символ ASCII: ";
+    out += message.symbol;
+    out += '\n';
+}
+
+void formatContinue(string& out, const CharMessage& message) {
+    out += "Поток ";
+    out += to_string(message.thread);
+    out += " продолжает выполнение: ";
+    out += message.symbol;
+    out += '\n';
+}
+
 // Функция для генерации случайного символа ASCII
+// У каждого потока свой генератор (раньше static-генератор был общим: гонка данных и скрытая сериализация)
 char generateRandomChar() {
-    static random_device rd; // Генератор случайных чисел
-    static mt19937 gen(rd()); // Вихрь Мерсенна для генерации случайных чисел
-    static uniform_int_distribution<> dis(32, 126); // Диапазон ASCII символов
-    return static_cast<char>(dis(gen)); // Возвращаем случайный символ
+    return static_cast<char>(32 + threadRandom().nextBelow(95)); // Диапазон ASCII символов 32..126
+}
+
+// ---------------------------------------------------------------------------
+// Аппаратные и программные счетчики производительности (Linux perf_event_open)
+// ---------------------------------------------------------------------------
+
+// Собираемые события
+enum PerfEvent {
+    PerfCycles,
+    PerfInstructions,
+    PerfLlcMisses,
+    PerfHitm,            // Передачи модифицированных строк кэша (raw-событие, зависит от модели процессора)
+    PerfContextSwitches,
+    PerfFutexCalls,      // Вызовы futex (tracepoint syscalls:sys_enter_futex)
+    PerfEventCount
+};
+
+// Имена событий в выводе
+const char* const perfEventNames[PerfEventCount] = {
+    "cycles", "instructions", "llc_misses", "hitm", "context_switches", "futex_calls",
+};
+
+// Настройки сбора счетчиков
+struct PerfConfig {
+    bool enabled = false;   // Собирать ли счетчики
+    uint64_t hitmEvent = 0; // Код raw-события для HITM (0 - не собирать)
+};
+
+// Значения счетчиков одного потока за запуск; NaN - событие недоступно
+using PerfSample = array<double, PerfEventCount>;
+
+// Номер tracepoint из tracefs; -1, если tracefs недоступна
+long long readTracepointId(const string& event) {
+    for (const char* root : {"/sys/kernel/tracing/events/", "/sys/kernel/debug/tracing/events/"}) {
+        ifstream in(string(root) + event + "/id");
+        long long id;
+        if (in >> id) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+// Счетчики одного потока. open() вызывается в самом потоке: события
+// привязываются к вызывающему потоку (pid = 0) на любом процессоре.
+class ThreadPerfCounters {
+public:
+    ThreadPerfCounters() {
+        fds.fill(-1);
+    }
+
+    ~ThreadPerfCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    ThreadPerfCounters(const ThreadPerfCounters&) = delete;
+    ThreadPerfCounters& operator=(const ThreadPerfCounters&) = delete;
+
+    void open(const PerfConfig& config) {
+#ifdef __linux__
+        fds[PerfCycles] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds[PerfInstructions] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[PerfLlcMisses] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        if (config.hitmEvent != 0) {
+            fds[PerfHitm] = openEvent(PERF_TYPE_RAW, config.hitmEvent);
+        }
+        fds[PerfContextSwitches] = openEvent(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+        long long futexId = readTracepointId("syscalls/sys_enter_futex");
+        if (futexId >= 0) {
+            fds[PerfFutexCalls] = openEvent(PERF_TYPE_TRACEPOINT, static_cast<uint64_t>(futexId));
+        }
+#else
+        (void)config;
+#endif
+    }
+
+    bool available(PerfEvent event) const {
+        return fds[event] >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // Остановка счетчиков и чтение значений с поправкой на мультиплексирование
+    PerfSample stop() {
+        PerfSample sample;
+        sample.fill(numeric_limits<double>::quiet_NaN());
+#ifdef __linux__
+        for (int e = 0; e < PerfEventCount; ++e) {
+            if (fds[e] >= 0) {
+                ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (int e = 0; e < PerfEventCount; ++e) {
+            uint64_t data[3]; // value, time_enabled, time_running
+            if (fds[e] >= 0 && read(fds[e], data, sizeof(data)) == sizeof(data)) {
+                double value = static_cast<double>(data[0]);
+                if (data[2] > 0 && data[2] < data[1]) {
+                    value *= static_cast<double>(data[1]) / data[2]; // Событие было мультиплексировано
+                }
+                sample[e] = value;
+            }
+        }
+#endif
+        return sample;
+    }
+
+private:
+#ifdef __linux__
+    static int openEvent(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd < 0 && type != PERF_TYPE_TRACEPOINT) {
+            // При perf_event_paranoid >= 2 непривилегированному процессу доступен только user-space
+            attr.exclude_kernel = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        return fd;
+    }
+#endif
+
+    array<int, PerfEventCount> fds;
+};
+
+// ---------------------------------------------------------------------------
+// Топология процессоров и пул рабочих потоков с привязкой к ядрам
+// ---------------------------------------------------------------------------
+
+// Описание логического процессора
+struct CpuInfo {
+    int cpu;      // Номер логического процессора
+    int core;     // Номер физического ядра внутри пакета
+    int package;  // Номер пакета (сокета)
+    int node;     // Номер NUMA-узла
+    int smtIndex; // Порядковый номер среди SMT-соседей одного ядра
+};
+
+// Раскладки привязки потоков к процессорам
+enum class PinLayout {
+    None,    // Без привязки, потоки распределяет планировщик
+    Compact, // Сначала разные ядра одного сокета, затем следующий сокет, затем SMT-соседи
+    Scatter, // По кругу между сокетами, чтобы соседние потоки оказывались на разных сокетах
+    Numa,    // Только процессоры одного NUMA-узла
+    Smt,     // Соседние потоки на SMT-соседях одного ядра (общие L1/L2)
+};
+
+// Чтение целого числа из файла sysfs; при ошибке возвращает fallback
+int readSysfsInt(const string& path, int fallback) {
+    ifstream in(path);
+    int value;
+    return (in >> value) ? value : fallback;
+}
+
+// Разбор списка процессоров в формате sysfs, например "0-3,8,10-11"
+vector<int> parseCpuList(const string& text) {
+    vector<int> cpus;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t dash = item.find('-');
+        try {
+            int first = stoi(item.substr(0, dash));
+            int last = (dash == string::npos) ? first : stoi(item.substr(dash + 1));
+            for (int c = first; c <= last; ++c) {
+                cpus.push_back(c);
+            }
+        } catch (...) {
+            // Пропускаем нераспознанный фрагмент
+        }
+    }
+    return cpus;
+}
+
+// Чтение топологии доступных процессу процессоров из /sys
+vector<CpuInfo> readCpuTopology() {
+    vector<int> allowed;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) {
+                allowed.push_back(c);
+            }
+        }
+    }
+#endif
+    if (allowed.empty()) {
+        for (unsigned c = 0; c < max(1u, thread::hardware_concurrency()); ++c) {
+            allowed.push_back(c);
+        }
+    }
+
+    // Номера NUMA-узлов берем из /sys/devices/system/node/nodeN/cpulist
+    vector<int> nodeOf(CPU_SETSIZE, 0);
+    error_code ec;
+    for (const auto& entry : filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+        string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 || !isdigit(static_cast<unsigned char>(name[4]))) {
+            continue;
+        }
+        int node = stoi(name.substr(4));
+        ifstream in(entry.path() / "cpulist");
+        string list;
+        getline(in, list);
+        for (int c : parseCpuList(list)) {
+            if (c >= 0 && c < CPU_SETSIZE) {
+                nodeOf[c] = node;
+            }
+        }
+    }
+
+    vector<CpuInfo> cpus;
+    for (int c : allowed) {
+        string base = "/sys/devices/system/cpu/cpu" + to_string(c) + "/topology/";
+        cpus.push_back({c, readSysfsInt(base + "core_id", c), readSysfsInt(base + "physical_package_id", 0), nodeOf[c], 0});
+    }
+    // SMT-индекс: номер процессора среди процессоров с тем же (package, core)
+    for (auto& info : cpus) {
+        for (const auto& other : cpus) {
+            if (other.package == info.package && other.core == info.core && other.cpu < info.cpu) {
+                ++info.smtIndex;
+            }
+        }
+    }
+    return cpus;
+}
+
+// Порядок процессоров для привязки потоков: поток i получает order[i % order.size()]
+vector<int> buildCpuOrder(PinLayout layout, vector<CpuInfo> cpus, int numaNode) {
+    auto byKey = [&cpus](auto key) {
+        sort(cpus.begin(), cpus.end(), [&key](const CpuInfo& a, const CpuInfo& b) { return key(a) < key(b); });
+    };
+    switch (layout) {
+    case PinLayout::None:
+        return {};
+    case PinLayout::Compact:
+        byKey([](const CpuInfo& c) { return make_tuple(c.smtIndex, c.package, c.core, c.cpu); });
+        break;
+    case PinLayout::Scatter: {
+        // Ранг ядра внутри своего пакета, чтобы чередовать пакеты
+        map<pair<int, int>, int> coreRank;
+        for (const auto& c : cpus) {
+            coreRank.emplace(make_pair(c.package, c.core), 0);
+        }
+        map<int, int> nextRank;
+        for (auto& [key, rank] : coreRank) {
+            rank = nextRank[key.first]++;
+        }
+        byKey([&coreRank](const CpuInfo& c) { return make_tuple(c.smtIndex, coreRank.at({c.package, c.core}), c.package, c.cpu); });
+        break;
+    }
+    case PinLayout::Numa:
+        cpus.erase(remove_if(cpus.begin(), cpus.end(), [numaNode](const CpuInfo& c) { return c.node != numaNode; }), cpus.end());
+        byKey([](const CpuInfo& c) { return make_tuple(c.smtIndex, c.package, c.core, c.cpu); });
+        break;
+    case PinLayout::Smt:
+        byKey([](const CpuInfo& c) { return make_tuple(c.package, c.core, c.smtIndex, c.cpu); });
+        break;
+    }
+    vector<int> order;
+    for (const auto& c : cpus) {
+        order.push_back(c.cpu);
+    }
+    return order;
+}
+
+// Привязка потока к одному процессору
+bool pinThread(thread& t, int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)t;
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Пул рабочих потоков, создаваемый один раз на весь бенчмарк.
+// Потоки запуска run() проходят стартовые ворота одновременно, и измеряется
+// только время от открытия ворот до завершения последнего потока, без
+// затрат на создание и join потоков.
+class WorkerPool {
+public:
+    WorkerPool(int numWorkers, const vector<int>& cpuOrder, const PerfConfig& perfConfig = {})
+        : perfConfig(perfConfig), perfSamples(numWorkers) {
+        for (int i = 0; i < numWorkers; ++i) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+            if (!cpuOrder.empty() && !pinThread(workers.back(), cpuOrder[i % cpuOrder.size()])) {
+                cerr << "Не удалось привязать поток " << i << " к процессору " << cpuOrder[i % cpuOrder.size()] << endl;
+            }
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(poolMutex);
+            stopping = true;
+        }
+        wakeCv.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(workers.size());
+    }
+
+    // Суммы счетчиков perf по участникам последнего запуска (NaN - событие недоступно)
+    PerfSample lastPerfTotals() const {
+        PerfSample totals;
+        totals.fill(0);
+        for (int i = 0; i < activeThreads; ++i) {
+            for (int e = 0; e < PerfEventCount; ++e) {
+                totals[e] += perfSamples[i].value[e];
+            }
+        }
+        return totals;
+    }
+
+    // Запуск job(index) на первых numThreads потоках пула; возвращает время синхронной фазы
+    chrono::duration<double> run(int numThreads, const function<void(int)>& job) {
+        numThreads = min(numThreads, size());
+        ready.store(0, memory_order_relaxed);
+        done.store(0, memory_order_relaxed);
+        gate.store(false, memory_order_relaxed);
+        {
+            lock_guard<mutex> lock(poolMutex);
+            currentJob = &job;
+            activeThreads = numThreads;
+            finished = false;
+            ++generation;
+        }
+        wakeCv.notify_all();
+
+        // Ждем, пока все участники встанут у ворот
+        while (ready.load(memory_order_acquire) < numThreads) {
+            this_thread::yield();
+        }
+        startTime = chrono::high_resolution_clock::now(); // Засекаем время начала
+        gate.store(true, memory_order_release); // Открываем ворота
+
+        unique_lock<mutex> lock(poolMutex);
+        doneCv.wait(lock, [this]() { return finished; });
+        currentJob = nullptr;
+        return endTime - startTime; // Время фиксирует последний завершившийся поток
+    }
+
+private:
+    void workerLoop(int index) {
+        ThreadPerfCounters counters; // Счетчики perf этого потока
+        if (perfConfig.enabled) {
+            counters.open(perfConfig);
+        }
+        uint64_t seenGeneration = 0;
+        while (true) {
+            const function<void(int)>* job;
+            int active;
+            {
+                unique_lock<mutex> lock(poolMutex);
+                wakeCv.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                job = currentJob;
+                active = activeThreads;
+            }
+            if (index >= active) {
+                continue; // Поток не участвует в этом запуске
+            }
+
+            ready.fetch_add(1, memory_order_acq_rel);
+            while (!gate.load(memory_order_acquire)) {
+                this_thread::yield(); // Ждем открытия ворот
+            }
+
+            // При включенных счетчиках в замер попадают несколько ioctl на поток
+            if (perfConfig.enabled) {
+                counters.start();
+            }
+            (*job)(index);
+            if (perfConfig.enabled) {
+                perfSamples[index].value = counters.stop();
+            }
+
+            if (done.fetch_add(1, memory_order_acq_rel) + 1 == active) {
+                endTime = chrono::high_resolution_clock::now(); // Засекаем время окончания
+                lock_guard<mutex> lock(poolMutex);
+                finished = true;
+                doneCv.notify_one();
+            }
+        }
+    }
+
+    struct alignas(64) PaddedPerfSample {
+        PerfSample value{};
+    };
+
+    PerfConfig perfConfig;
+    vector<PaddedPerfSample> perfSamples; // Счетчики каждого потока за последний запуск
+    vector<thread> workers;
+    mutex poolMutex;
+    condition_variable wakeCv;  // Пробуждение потоков для нового запуска
+    condition_variable doneCv;  // Сигнал о завершении запуска
+    const function<void(int)>* currentJob = nullptr;
+    int activeThreads = 0;
+    uint64_t generation = 0;
+    bool finished = false;
+    bool stopping = false;
+    alignas(64) atomic<int> ready{0};    // Сколько потоков стоит у ворот
+    alignas(64) atomic<bool> gate{false}; // Стартовые ворота
+    alignas(64) atomic<int> done{0};     // Сколько потоков завершили работу
+    chrono::high_resolution_clock::time_point startTime;
+    chrono::high_resolution_clock::time_point endTime;
+};
+
+// ---------------------------------------------------------------------------
+// Семафоры
+// ---------------------------------------------------------------------------
+
+// Подсказка процессору, что поток крутится в цикле ожидания
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    this_thread::yield();
+#endif
+}
+
+// Ожидание на futex, пока слово равно expected (возможны ложные пробуждения)
+inline void futexWait(atomic<int32_t>& word, int32_t expected) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<int32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    word.wait(expected);
+#endif
+}
+
+// Пробуждение до count потоков, ожидающих на futex
+inline void futexWake(atomic<int32_t>& word, int32_t count) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<int32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+    count == 1 ? word.notify_one() : word.notify_all();
+#endif
+}
+
+// Исходная эмуляция семафора: мьютекс + условная переменная + счетчик.
+// Каждый acquire/release проходит через мьютекс и notify_one.
+class CvSemaphore {
+public:
+    explicit CvSemaphore(int permits) : count(permits) {}
+
+    void acquire() {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this]() { return count > 0; });
+        --count;
+    }
+
+    void release() {
+        {
+            lock_guard<mutex> lock(m);
+            ++count;
+        }
+        cv.notify_one();
+    }
+
+private:
+    mutex m;
+    condition_variable cv;
+    int count;
+};
+
+// Счетный семафор на futex: без конкуренции acquire/release - одна атомарная операция,
+// системный вызов выполняется только при реальном ожидании или наличии ожидающих.
+class FutexSemaphore {
+public:
+    explicit FutexSemaphore(int permits) : count(permits) {}
+
+    void acquire() {
+        if (tryAcquire()) {
+            return;
+        }
+        waiters.fetch_add(1, memory_order_seq_cst);
+        while (!tryAcquire()) {
+            futexWait(count, 0); // Спим, пока разрешений нет
+        }
+        waiters.fetch_sub(1, memory_order_relaxed);
+    }
+
+    bool tryAcquire() {
+        int32_t c = count.load(memory_order_relaxed);
+        while (c > 0) {
+            if (count.compare_exchange_weak(c, c - 1, memory_order_acquire, memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void release() {
+        count.fetch_add(1, memory_order_seq_cst);
+        // seq_cst в паре с waiters.fetch_add в acquire: либо ожидающий увидит разрешение,
+        // либо мы увидим ожидающего и разбудим его
+        if (waiters.load(memory_order_seq_cst) > 0) {
+            futexWake(count, 1);
+        }
+    }
+
+private:
+    alignas(64) atomic<int32_t> count;
+    atomic<int32_t> waiters{0};
+};
+
+// Аналог SemaphoreSlim из .NET: атомарный быстрый путь, затем короткое вращение
+// с паузой и только после этого засыпание на мьютексе и условной переменной.
+class SlimSemaphore {
+public:
+    explicit SlimSemaphore(int permits, int spinCount = 100) : count(permits), spinCount(spinCount) {}
+
+    void acquire() {
+        for (int spin = 0; spin <= spinCount; ++spin) {
+            if (tryAcquire()) {
+                return;
+            }
+            cpuRelax();
+        }
+        unique_lock<mutex> lock(m);
+        waiters.fetch_add(1, memory_order_seq_cst);
+        cv.wait(lock, [this]() { return tryAcquire(); });
+        waiters.fetch_sub(1, memory_order_relaxed);
+    }
+
+    bool tryAcquire() {
+        int32_t c = count.load(memory_order_relaxed);
+        while (c > 0) {
+            if (count.compare_exchange_weak(c, c - 1, memory_order_acquire, memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void release() {
+        count.fetch_add(1, memory_order_seq_cst);
+        if (waiters.load(memory_order_seq_cst) > 0) {
+            // Мьютекс не дает уведомлению проскочить между проверкой условия и засыпанием
+            lock_guard<mutex> lock(m);
+            cv.notify_one();
+        }
+    }
+
+private:
+    alignas(64) atomic<int32_t> count;
+    atomic<int32_t> waiters{0};
+    int spinCount;
+    mutex m;
+    condition_variable cv;
+};
+
+// Адаптер std::counting_semaphore к общему интерфейсу
+class StdCountingSemaphore {
+public:
+    explicit StdCountingSemaphore(int permits) : semaphore(permits) {}
+
+    void acquire() {
+        semaphore.acquire();
+    }
+
+    void release() {
+        semaphore.release();
+    }
+
+private:
+    counting_semaphore<> semaphore;
+};
+
+// Адаптер std::binary_semaphore: число разрешений всегда 1
+class StdBinarySemaphore {
+public:
+    explicit StdBinarySemaphore(int) : semaphore(1) {}
+
+    void acquire() {
+        semaphore.acquire();
+    }
+
+    void release() {
+        semaphore.release();
+    }
+
+private:
+    binary_semaphore semaphore;
+};
+
+// ---------------------------------------------------------------------------
+// Спинлоки: общий интерфейс lock()/unlock(), как у std::mutex
+// ---------------------------------------------------------------------------
+
+// Одна итерация цикла ожидания: pause, а после долгого ожидания - yield, чтобы при
+// числе потоков больше числа ядер не отнимать квант у вытесненного владельца
+inline void spinWaitOnce(int& spins) {
+    if (spins < 1024) {
+        ++spins;
+        cpuRelax();
+    } else {
+        this_thread::yield();
+    }
+}
+
+// Исходный спинлок: exchange в цикле без паузы и без предварительного чтения
+class NaiveSpinLock {
+public:
+    void lock() {
+        while (flag.exchange(true, memory_order_acquire)) {
+            // Spin until lock is acquired
+        }
+    }
+
+    void unlock() {
+        flag.store(false, memory_order_release);
+    }
+
+private:
+    alignas(64) atomic<bool> flag{false};
+};
+
+// Test-and-test-and-set с экспоненциальной задержкой: пока замок занят, крутимся
+// на чтении локальной копии строки кэша и только потом пробуем exchange
+class TtasSpinLock {
+public:
+    void lock() {
+        int delay = 1;
+        int spins = 0;
+        while (true) {
+            while (flag.load(memory_order_relaxed)) {
+                spinWaitOnce(spins);
+            }
+            if (!flag.exchange(true, memory_order_acquire)) {
+                return;
+            }
+            // Проиграли гонку за освободившийся замок - отступаем, чтобы не штурмовать строку кэша
+            for (int i = 0; i < delay; ++i) {
+                cpuRelax();
+            }
+            delay = min(delay * 2, maxDelay);
+        }
+    }
+
+    void unlock() {
+        flag.store(false, memory_order_release);
+    }
+
+private:
+    static constexpr int maxDelay = 1024;
+    alignas(64) atomic<bool> flag{false};
+};
+
+// Билетный замок: строгий FIFO, ожидание пропорционально числу потоков впереди
+class TicketLock {
+public:
+    void lock() {
+        uint32_t ticket = nextTicket.fetch_add(1, memory_order_relaxed);
+        int spins = 0;
+        while (true) {
+            uint32_t serving = nowServing.load(memory_order_acquire);
+            if (serving == ticket) {
+                return;
+            }
+            for (uint32_t i = 0; i < ticket - serving; ++i) {
+                spinWaitOnce(spins);
+            }
+        }
+    }
+
+    void unlock() {
+        // Писать nowServing может только владелец, поэтому атомарный инкремент не нужен
+        nowServing.store(nowServing.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+private:
+    alignas(64) atomic<uint32_t> nextTicket{0};
+    alignas(64) atomic<uint32_t> nowServing{0};
+};
+
+// Очередь MCS: каждый ожидающий крутится на флаге в своем узле, поэтому передача
+// замка затрагивает одну строку кэша. Узел у потока один (thread_local), так что
+// поток не должен держать два MCS-замка одновременно.
+class McsLock {
+public:
+    void lock() {
+        Node& node = localNode;
+        node.next.store(nullptr, memory_order_relaxed);
+        node.locked.store(true, memory_order_relaxed);
+        Node* pred = tail.exchange(&node, memory_order_acq_rel);
+        if (pred != nullptr) {
+            pred->next.store(&node, memory_order_release);
+            int spins = 0;
+            while (node.locked.load(memory_order_acquire)) {
+                spinWaitOnce(spins);
+            }
+        }
+    }
+
+    void unlock() {
+        Node& node = localNode;
+        Node* succ = node.next.load(memory_order_acquire);
+        if (succ == nullptr) {
+            Node* expected = &node;
+            if (tail.compare_exchange_strong(expected, nullptr, memory_order_release, memory_order_relaxed)) {
+                return; // Очередь пуста
+            }
+            // Преемник уже встал в хвост, но еще не записал ссылку на себя
+            int spins = 0;
+            while ((succ = node.next.load(memory_order_acquire)) == nullptr) {
+                spinWaitOnce(spins);
+            }
+        }
+        succ->locked.store(false, memory_order_release);
+    }
+
+private:
+    struct alignas(64) Node {
+        atomic<Node*> next{nullptr};
+        atomic<bool> locked{false};
+    };
+
+    static thread_local Node localNode;
+    alignas(64) atomic<Node*> tail{nullptr};
+};
+
+thread_local McsLock::Node McsLock::localNode;
+
+// Очередь CLH: ожидающий крутится на узле предшественника, а после освобождения
+// забирает этот узел себе. Каждый узел в любой момент принадлежит либо одному
+// потоку, либо хвосту свободного замка, поэтому деструкторы освобождают все узлы.
+class ClhLock {
+public:
+    ClhLock() : tail(new Node) {}
+
+    ~ClhLock() {
+        delete tail.load(memory_order_relaxed);
+    }
+
+    ClhLock(const ClhLock&) = delete;
+    ClhLock& operator=(const ClhLock&) = delete;
+
+    void lock() {
+        Node* node = local.mine;
+        node->locked.store(true, memory_order_relaxed);
+        Node* pred = tail.exchange(node, memory_order_acq_rel);
+        local.pred = pred;
+        int spins = 0;
+        while (pred->locked.load(memory_order_acquire)) {
+            spinWaitOnce(spins);
+        }
+    }
+
+    void unlock() {
+        Node* node = local.mine;
+        local.mine = local.pred; // Узел предшественника больше никто не читает
+        node->locked.store(false, memory_order_release);
+    }
+
+private:
+    struct alignas(64) Node {
+        atomic<bool> locked{false};
+    };
+
+    struct ThreadNodes {
+        Node* mine = new Node;
+        Node* pred = nullptr;
+
+        ~ThreadNodes() {
+            delete mine;
+        }
+    };
+
+    static thread_local ThreadNodes local;
+    alignas(64) atomic<Node*> tail;
+};
+
+thread_local ClhLock::ThreadNodes ClhLock::local;
+
+// ---------------------------------------------------------------------------
+// Многоразовые барьеры: общий интерфейс wait(index), index - номер потока 0..n-1
+// ---------------------------------------------------------------------------
+
+// Барьер на мьютексе и одной условной переменной (развитие исходного testBarrier):
+// номер поколения делает его многоразовым, но notify_all будит всех ожидающих,
+// и они по очереди проходят через один мьютекс.
+class CvBarrier {
+public:
+    explicit CvBarrier(int numThreads) : numThreads(numThreads) {}
+
+    void wait(int) {
+        unique_lock<mutex> lock(m);
+        uint64_t myGeneration = generation;
+        if (++count == numThreads) {
+            count = 0;
+            ++generation;
+            cv.notify_all(); // Все потоки достигли барьера
+        } else {
+            cv.wait(lock, [this, myGeneration]() { return generation != myGeneration; });
+        }
+    }
+
+private:
+    mutex m;
+    condition_variable cv;
+    int numThreads;
+    int count = 0;
+    uint64_t generation = 0;
+};
+
+// Централизованный барьер с обращением смысла (sense-reversing): последний
+// пришедший сбрасывает счетчик и переключает общий флаг, остальные крутятся на нем.
+class SenseBarrier {
+public:
+    explicit SenseBarrier(int numThreads) : numThreads(numThreads), count(numThreads), localSense(numThreads) {}
+
+    void wait(int index) {
+        bool mySense = !localSense[index].value;
+        localSense[index].value = mySense;
+        if (count.fetch_sub(1, memory_order_acq_rel) == 1) {
+            count.store(numThreads, memory_order_relaxed);
+            sense.store(mySense, memory_order_release);
+        } else {
+            int spins = 0;
+            while (sense.load(memory_order_acquire) != mySense) {
+                spinWaitOnce(spins);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) PaddedFlag {
+        bool value = false;
+    };
+
+    int numThreads;
+    alignas(64) atomic<int> count;
+    alignas(64) atomic<bool> sense{false};
+    vector<PaddedFlag> localSense; // Смысл текущей фазы у каждого потока
+};
+
+// Барьер на дереве объединения: потоки прибывают группами по fanIn в листья,
+// последний в узле поднимается к родителю, поэтому на каждом счетчике
+// соперничают не более fanIn потоков. Освобождение идет сверху вниз по флагам узлов.
+class TreeBarrier {
+public:
+    explicit TreeBarrier(int numThreads, int fanIn = 4) : fanIn(fanIn), localSense(numThreads) {
+        // Листья: по fanIn потоков на лист
+        int levelSize = (numThreads + fanIn - 1) / fanIn;
+        for (int i = 0; i < levelSize; ++i) {
+            nodes.push_back(make_unique<Node>(min(fanIn, numThreads - i * fanIn)));
+        }
+        // Внутренние уровни до единственного корня
+        size_t levelStart = 0;
+        while (levelSize > 1) {
+            int parentSize = (levelSize + fanIn - 1) / fanIn;
+            size_t parentStart = nodes.size();
+            for (int i = 0; i < parentSize; ++i) {
+                nodes.push_back(make_unique<Node>(min(fanIn, levelSize - i * fanIn)));
+            }
+            for (int i = 0; i < levelSize; ++i) {
+                nodes[levelStart + i]->parent = nodes[parentStart + i / fanIn].get();
+            }
+            levelStart = parentStart;
+            levelSize = parentSize;
+        }
+    }
+
+    void wait(int index) {
+        bool mySense = !localSense[index].value;
+        localSense[index].value = mySense;
+        arrive(nodes[index / fanIn].get(), mySense);
+    }
+
+private:
+    struct alignas(64) Node {
+        explicit Node(int size) : size(size), count(size) {}
+
+        int size;
+        Node* parent = nullptr;
+        atomic<int> count;
+        atomic<bool> sense{false};
+    };
+
+    struct alignas(64) PaddedFlag {
+        bool value = false;
+    };
+
+    void arrive(Node* node, bool mySense) {
+        if (node->count.fetch_sub(1, memory_order_acq_rel) == 1) {
+            if (node->parent != nullptr) {
+                arrive(node->parent, mySense); // Последний в узле представляет его на уровне выше
+            }
+            node->count.store(node->size, memory_order_relaxed);
+            node->sense.store(mySense, memory_order_release);
+        } else {
+            int spins = 0;
+            while (node->sense.load(memory_order_acquire) != mySense) {
+                spinWaitOnce(spins);
+            }
+        }
+    }
+
+    int fanIn;
+    vector<unique_ptr<Node>> nodes;
+    vector<PaddedFlag> localSense;
+};
+
+// Барьер распространения (dissemination): за ceil(log2 n) раундов поток i сигналит
+// потоку (i + 2^r) mod n и ждет сигнала от (i - 2^r) mod n. Общих счетчиков нет,
+// каждый флаг пишет ровно один поток. Флаги - монотонные счетчики фаз, поэтому
+// обращение смысла не требуется.
+class DisseminationBarrier {
+public:
+    explicit DisseminationBarrier(int numThreads) : numThreads(numThreads), threads(numThreads) {
+        for (int distance = 1; distance < numThreads; distance *= 2) {
+            ++rounds;
+        }
+        for (auto& t : threads) {
+            t.flags = make_unique<PaddedCounter[]>(rounds);
+        }
+    }
+
+    void wait(int index) {
+        ThreadState& self = threads[index];
+        uint32_t episode = ++self.episode;
+        for (int r = 0, distance = 1; r < rounds; ++r, distance *= 2) {
+            threads[(index + distance) % numThreads].flags[r].value.fetch_add(1, memory_order_release);
+            int spins = 0;
+            while (self.flags[r].value.load(memory_order_acquire) < episode) {
+                spinWaitOnce(spins);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) PaddedCounter {
+        atomic<uint32_t> value{0};
+    };
+
+    struct alignas(64) ThreadState {
+        uint32_t episode = 0;
+        unique_ptr<PaddedCounter[]> flags; // Сигналы, полученные в каждом раунде
+    };
+
+    int numThreads;
+    int rounds = 0;
+    vector<ThreadState> threads;
+};
+
+// Адаптер std::barrier
+class StdBarrier {
+public:
+    explicit StdBarrier(int numThreads) : impl(numThreads) {}
+
+    void wait(int) {
+        impl.arrive_and_wait();
+    }
+
+private:
+    std::barrier<> impl;
+};
+
+// ---------------------------------------------------------------------------
+// Блокировки читателей-писателей: lock()/unlock() для записи,
+// lock_shared()/unlock_shared() для чтения, как у std::shared_mutex
+// ---------------------------------------------------------------------------
+
+// RW-блокировка на futex с приоритетом писателей: пока писатель ждет, новые
+// читатели не входят. Все состояние - одно 32-битное слово.
+class FutexRwLock {
+public:
+    void lock() {
+        int spins = 0;
+        int32_t s = state.load(memory_order_relaxed);
+        while (true) {
+            if ((s & (readerMask | writerBit)) == 0) {
+                // Захват сбрасывает флаг ожидающих писателей; остальные писатели выставят его снова
+                if (state.compare_exchange_weak(s, writerBit | (s & readersWaitingBit), memory_order_acquire,
+                                                memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+            if (spins < spinLimit) {
+                ++spins;
+                cpuRelax();
+                s = state.load(memory_order_relaxed);
+                continue;
+            }
+            if (!(s & writersWaitingBit) &&
+                !state.compare_exchange_weak(s, s | writersWaitingBit, memory_order_relaxed)) {
+                continue;
+            }
+            futexWait(state, s | writersWaitingBit);
+            s = state.load(memory_order_relaxed);
+        }
+    }
+
+    void unlock() {
+        int32_t prev = state.exchange(0, memory_order_release);
+        if (prev & (writersWaitingBit | readersWaitingBit)) {
+            futexWake(state, numeric_limits<int32_t>::max());
+        }
+    }
+
+    void lock_shared() {
+        int spins = 0;
+        int32_t s = state.load(memory_order_relaxed);
+        while (true) {
+            if ((s & (writerBit | writersWaitingBit)) == 0) {
+                if (state.compare_exchange_weak(s, s + 1, memory_order_acquire, memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+            if (spins < spinLimit) {
+                ++spins;
+                cpuRelax();
+                s = state.load(memory_order_relaxed);
+                continue;
+            }
+            if (!(s & readersWaitingBit) &&
+                !state.compare_exchange_weak(s, s | readersWaitingBit, memory_order_relaxed)) {
+                continue;
+            }
+            futexWait(state, s | readersWaitingBit);
+            s = state.load(memory_order_relaxed);
+        }
+    }
+
+    void unlock_shared() {
+        int32_t prev = state.fetch_sub(1, memory_order_release);
+        // Последний читатель будит писателя, который ждет, пока читатели выйдут
+        if ((prev & readerMask) == 1 && (prev & writersWaitingBit)) {
+            futexWake(state, numeric_limits<int32_t>::max());
+        }
+    }
+
+private:
+    static constexpr int32_t readerMask = (1 << 28) - 1;  // Число читателей внутри
+    static constexpr int32_t readersWaitingBit = 1 << 28; // Есть спящие читатели
+    static constexpr int32_t writersWaitingBit = 1 << 29; // Есть ждущие писатели
+    static constexpr int32_t writerBit = 1 << 30;         // Блокировка занята писателем
+    static constexpr int spinLimit = 100;                  // Попыток до сна на futex
+
+    alignas(64) atomic<int32_t> state{0};
+};
+
+// Распределенная RW-блокировка ("big-reader"): у каждого процессора свой счетчик
+// читателей в отдельной строке кэша, поэтому читатели на разных ядрах не делят
+// ни одной строки. Писатель выставляет флаг и ждет опустошения всех счетчиков.
+class BigReaderLock {
+public:
+    BigReaderLock() : slots(slotCount()) {}
+
+    void lock() {
+        writerMutex.lock(); // Писатели между собой упорядочиваются обычным мьютексом
+        writer.store(true, memory_order_seq_cst);
+        for (auto& slot : slots) {
+            int spins = 0;
+            while (slot.readers.load(memory_order_seq_cst) != 0) {
+                spinWaitOnce(spins);
+            }
+        }
+    }
+
+    void unlock() {
+        writer.store(false, memory_order_release);
+        writerMutex.unlock();
+    }
+
+    void lock_shared() {
+        Slot& slot = slots[localSlot() % slots.size()];
+        while (true) {
+            // Пара seq_cst-операций с обратным порядком у писателя: либо писатель увидит
+            // читателя, либо читатель увидит флаг писателя
+            slot.readers.fetch_add(1, memory_order_seq_cst);
+            if (!writer.load(memory_order_seq_cst)) {
+                return;
+            }
+            slot.readers.fetch_sub(1, memory_order_relaxed);
+            int spins = 0;
+            while (writer.load(memory_order_relaxed)) {
+                spinWaitOnce(spins);
+            }
+        }
+    }
+
+    void unlock_shared() {
+        slots[localSlot() % slots.size()].readers.fetch_sub(1, memory_order_release);
+    }
+
+private:
+    struct alignas(64) Slot {
+        atomic<int> readers{0};
+    };
+
+    static size_t slotCount() {
+        return max(1u, thread::hardware_concurrency());
+    }
+
+    // Счетчик потока - по процессору, на котором он впервые взял блокировку;
+    // у привязанных потоков пула это и есть их ядро
+    static size_t localSlot() {
+        thread_local size_t slot = [] {
+            int cpu = sched_getcpu();
+            return cpu >= 0 ? static_cast<size_t>(cpu) : 0;
+        }();
+        return slot;
+    }
+
+    vector<Slot> slots;
+    alignas(64) atomic<bool> writer{false};
+    mutex writerMutex;
+};
+
+// Seqlock: писатели захватывают нечетное значение счетчика версий, читатели не пишут
+// в общую память вовсе - читают данные оптимистично и повторяют, если версия сменилась.
+// Данные, которые читаются под seqlock, должны читаться атомарными операциями.
+class SeqLock {
+public:
+    void lock() {
+        int spins = 0;
+        uint32_t s = seq.load(memory_order_relaxed);
+        while ((s & 1) || !seq.compare_exchange_weak(s, s + 1, memory_order_relaxed)) {
+            spinWaitOnce(spins);
+            s = seq.load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_release); // Нечетная версия видна раньше новых данных
+    }
+
+    void unlock() {
+        seq.fetch_add(1, memory_order_release);
+    }
+
+    // Оптимистичное чтение: read() повторяется, пока не выполнится без пересечения
+    // с писателем; возвращает число повторов
+    template <typename Read>
+    uint64_t read(Read&& read) const {
+        uint64_t retries = 0;
+        while (true) {
+            uint32_t before = seq.load(memory_order_acquire);
+            if (before & 1) {
+                cpuRelax(); // Идет запись
+                continue;
+            }
+            read();
+            atomic_thread_fence(memory_order_acquire);
+            if (seq.load(memory_order_relaxed) == before) {
+                return retries;
+            }
+            ++retries;
+        }
+    }
+
+private:
+    alignas(64) atomic<uint32_t> seq{0};
+};
+
+// ---------------------------------------------------------------------------
+// Парковка потоков (по образцу WTF::ParkingLot): очереди ожидания хранятся не в
+// самих примитивах, а в общей хеш-таблице по адресу. Поэтому мьютексу хватает
+// одного байта, условной переменной - одного флага.
+// ---------------------------------------------------------------------------
+
+// Что сообщается функции обратного вызова при unparkOne
+struct UnparkResult {
+    bool didUnparkThread = false;    // Разбужен ли поток
+    bool mayHaveMoreThreads = false; // Остались ли потоки на этом адресе
+    bool timeToBeFair = false;       // Пора передать владение разбуженному напрямую
+};
+
+class ParkingLot {
+public:
+    // Парковка на адресе: под замком корзины вызывается validate(), и если она вернула
+    // true, поток встает в очередь, вызывает beforeSleep() уже без замка и засыпает
+    // до unpark. Возвращает token, переданный будившим, или nullopt, если парковки не было.
+    template <typename Validate, typename BeforeSleep>
+    static optional<intptr_t> parkConditionally(const void* address, Validate&& validate, BeforeSleep&& beforeSleep) {
+        ThreadData& self = localThreadData();
+        Bucket& bucket = bucketFor(address);
+        bucket.lock.lock();
+        if (!validate()) {
+            bucket.lock.unlock();
+            return nullopt;
+        }
+        self.address = address;
+        self.next = nullptr;
+        self.parked.store(1, memory_order_relaxed);
+        if (bucket.tail) {
+            bucket.tail->next = &self;
+        } else {
+            bucket.head = &self;
+        }
+        bucket.tail = &self;
+        bucket.lock.unlock();
+
+        beforeSleep();
+        while (self.parked.load(memory_order_acquire) != 0) {
+            futexWait(self.parked, 1);
+        }
+        return self.token;
+    }
+
+    // Будит первый поток, припаркованный на адресе. callback вызывается под замком
+    // корзины (даже если будить некого) и возвращает token для разбуженного потока.
+    template <typename Callback>
+    static void unparkOne(const void* address, Callback&& callback) {
+        Bucket& bucket = bucketFor(address);
+        bucket.lock.lock();
+        ThreadData* prev = nullptr;
+        ThreadData* found = bucket.head;
+        while (found && found->address != address) {
+            prev = found;
+            found = found->next;
+        }
+        UnparkResult result;
+        if (found) {
+            unlink(bucket, prev, found);
+            result.didUnparkThread = true;
+            for (ThreadData* t = found->next; t; t = t->next) {
+                if (t->address == address) {
+                    result.mayHaveMoreThreads = true;
+                    break;
+                }
+            }
+            // Передача владения не чаще раза в среднем за полмиллисекунды на корзину:
+            // редкая честность не мешает пропускной способности, но исключает голодание
+            auto now = chrono::steady_clock::now();
+            if (now >= bucket.nextFairTime) {
+                result.timeToBeFair = true;
+                bucket.nextFairTime = now + chrono::nanoseconds(threadRandom().nextBelow(1000000));
+            }
+        }
+        intptr_t token = callback(result);
+        bucket.lock.unlock();
+        if (found) {
+            wake(*found, token);
+        }
+    }
+
+    // Будит все потоки, припаркованные на адресе
+    static void unparkAll(const void* address) {
+        Bucket& bucket = bucketFor(address);
+        ThreadData* woken = nullptr;
+        bucket.lock.lock();
+        ThreadData* prev = nullptr;
+        ThreadData* t = bucket.head;
+        while (t) {
+            ThreadData* next = t->next;
+            if (t->address == address) {
+                unlink(bucket, prev, t);
+                t->next = woken;
+                woken = t;
+            } else {
+                prev = t;
+            }
+            t = next;
+        }
+        bucket.lock.unlock();
+        while (woken) {
+            ThreadData* next = woken->next; // Читаем до пробуждения: после него запись принадлежит потоку
+            wake(*woken, 0);
+            woken = next;
+        }
+    }
+
+private:
+    // Запись о потоке; живет в thread_local и стоит в очереди только пока поток спит
+    struct ThreadData {
+        atomic<int32_t> parked{0}; // Слово futex: 1, пока поток припаркован
+        const void* address = nullptr;
+        ThreadData* next = nullptr;
+        intptr_t token = 0;
+    };
+
+    // Корзина хеш-таблицы: очередь FIFO всех адресов, попавших в корзину
+    struct alignas(64) Bucket {
+        TtasSpinLock lock;
+        ThreadData* head = nullptr;
+        ThreadData* tail = nullptr;
+        chrono::steady_clock::time_point nextFairTime{};
+    };
+
+    // Таблица фиксированного размера: корзин заведомо больше, чем потоков в тестах
+    static constexpr size_t bucketCount = 1024;
+
+    static ThreadData& localThreadData() {
+        thread_local ThreadData data;
+        return data;
+    }
+
+    static Bucket& bucketFor(const void* address) {
+        static unique_ptr<Bucket[]> buckets(new Bucket[bucketCount]);
+        uint64_t key = reinterpret_cast<uintptr_t>(address) * 0x9e3779b97f4a7c15ULL;
+        return buckets[(key >> 32) % bucketCount];
+    }
+
+    static void unlink(Bucket& bucket, ThreadData* prev, ThreadData* t) {
+        (prev ? prev->next : bucket.head) = t->next;
+        if (bucket.tail == t) {
+            bucket.tail = prev;
+        }
+    }
+
+    static void wake(ThreadData& t, intptr_t token) {
+        t.token = token;
+        t.parked.store(0, memory_order_release);
+        futexWake(t.parked, 1);
+    }
+};
+
+// Однобайтовый мьютекс (как WTF::Lock): бит захвата и бит "есть припаркованные".
+// Сначала недолго крутится, пока никто не спит, затем паркуется на своем адресе.
+// Время от времени unlock передает замок разбуженному потоку напрямую.
+class ByteLock {
+public:
+    void lock() {
+        uint8_t expected = 0;
+        if (!bits.compare_exchange_weak(expected, heldBit, memory_order_acquire, memory_order_relaxed)) {
+            lockSlow();
+        }
+    }
+
+    void unlock() {
+        uint8_t expected = heldBit;
+        if (!bits.compare_exchange_strong(expected, 0, memory_order_release, memory_order_relaxed)) {
+            unlockSlow();
+        }
+    }
+
+private:
+    static constexpr uint8_t heldBit = 1;
+    static constexpr uint8_t parkedBit = 2;
+    static constexpr int spinLimit = 40;
+    static constexpr intptr_t directHandoff = 1;
+
+    void lockSlow() {
+        int spins = 0;
+        while (true) {
+            uint8_t current = bits.load(memory_order_relaxed);
+            if (!(current & heldBit)) {
+                if (bits.compare_exchange_weak(current, current | heldBit, memory_order_acquire,
+                                               memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+            // Крутимся, только пока очередь пуста: иначе замок все равно достанется спящим
+            if (!(current & parkedBit) && spins < spinLimit) {
+                ++spins;
+                this_thread::yield();
+                continue;
+            }
+            if (!(current & parkedBit) &&
+                !bits.compare_exchange_weak(current, current | parkedBit, memory_order_relaxed)) {
+                continue;
+            }
+            auto token = ParkingLot::parkConditionally(
+                this, [this]() { return bits.load(memory_order_relaxed) == (heldBit | parkedBit); }, []() {});
+            if (token && *token == directHandoff) {
+                atomic_thread_fence(memory_order_acquire);
+                return; // Замок передан нам, heldBit не сбрасывался
+            }
+        }
+    }
+
+    void unlockSlow() {
+        ParkingLot::unparkOne(this, [this](const UnparkResult& result) -> intptr_t {
+            if (result.didUnparkThread && result.timeToBeFair) {
+                bits.store(heldBit | (result.mayHaveMoreThreads ? parkedBit : 0), memory_order_release);
+                return directHandoff;
+            }
+            bits.store(result.mayHaveMoreThreads ? parkedBit : 0, memory_order_release);
+            return 0;
+        });
+    }
+
+    atomic<uint8_t> bits{0};
+};
+static_assert(sizeof(ByteLock) == 1, "ByteLock должен занимать один байт");
+
+// Условная переменная из одного флага "есть ожидающие" поверх парковки
+class ParkingCondition {
+public:
+    // Ожидание при захваченном lock; как и у condition_variable, возможны ложные пробуждения
+    template <typename Lock>
+    void wait(Lock& lock) {
+        ParkingLot::parkConditionally(
+            this,
+            [this]() {
+                hasWaiters.store(true, memory_order_relaxed);
+                return true;
+            },
+            [&lock]() { lock.unlock(); });
+        lock.lock();
+    }
+
+    template <typename Lock, typename Predicate>
+    void wait(Lock& lock, Predicate pred) {
+        while (!pred()) {
+            wait(lock);
+        }
+    }
+
+    void notifyOne() {
+        if (!hasWaiters.load(memory_order_relaxed)) {
+            return;
+        }
+        ParkingLot::unparkOne(this, [this](const UnparkResult& result) -> intptr_t {
+            hasWaiters.store(result.mayHaveMoreThreads, memory_order_relaxed);
+            return 0;
+        });
+    }
+
+    void notifyAll() {
+        if (!hasWaiters.load(memory_order_relaxed)) {
+            return;
+        }
+        hasWaiters.store(false, memory_order_relaxed);
+        ParkingLot::unparkAll(this);
+    }
+
+private:
+    atomic<bool> hasWaiters{false};
+};
+
+// Семафор в 8 байт: счетчик и флаг ожидающих, очередь - в парковке.
+// Тот же протокол, что у SlimSemaphore, только без мьютекса и condition_variable.
+class ParkingSemaphore {
+public:
+    explicit ParkingSemaphore(int permits) : count(permits) {}
+
+    void acquire() {
+        for (int spin = 0; spin <= spinCount; ++spin) {
+            if (tryAcquire()) {
+                return;
+            }
+            cpuRelax();
+        }
+        while (!tryAcquire()) {
+            ParkingLot::parkConditionally(
+                &count,
+                [this]() {
+                    // Пара seq_cst с release(): либо мы увидим разрешение, либо release увидит флаг
+                    waiting.store(true, memory_order_seq_cst);
+                    return count.load(memory_order_seq_cst) <= 0;
+                },
+                []() {});
+        }
+    }
+
+    bool tryAcquire() {
+        int32_t c = count.load(memory_order_relaxed);
+        while (c > 0) {
+            if (count.compare_exchange_weak(c, c - 1, memory_order_acquire, memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void release() {
+        count.fetch_add(1, memory_order_seq_cst);
+        if (waiting.load(memory_order_seq_cst)) {
+            ParkingLot::unparkOne(&count, [this](const UnparkResult& result) -> intptr_t {
+                waiting.store(result.mayHaveMoreThreads, memory_order_relaxed);
+                return 0;
+            });
+        }
+    }
+
+private:
+    static constexpr int spinCount = 100;
+
+    atomic<int32_t> count;
+    atomic<bool> waiting{false};
+};
+
+// ---------------------------------------------------------------------------
+// Примитивы для сопрограмм C++20: ожидающий не занимает поток ОС, а
+// приостанавливается и при пробуждении возвращается в очередь исполнителя
+// ---------------------------------------------------------------------------
+
+// Исполнитель: очередь сопрограмм, готовых продолжить работу
+class Executor {
+public:
+    virtual ~Executor() = default;
+    virtual void post(coroutine_handle<> handle) = 0;
+    // Выполнять сопрограммы; возвращается, когда работа кончилась или вызван stop()
+    virtual void run() = 0;
+    virtual void stop() {}
+};
+
+// Однопоточный исполнитель: очередь без синхронизации, run() выполняет ее до опустошения
+class InlineExecutor : public Executor {
+public:
+    void post(coroutine_handle<> handle) override {
+        ready.push_back(handle);
+    }
+
+    void run() override {
+        while (!ready.empty()) {
+            coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+        }
+    }
+
+private:
+    deque<coroutine_handle<>> ready;
+};
+
+// Многопоточный исполнитель: общая очередь под мьютексом, run() вызывает каждый
+// рабочий поток. Пустая очередь не значит конец работы - сопрограммы могут ждать
+// друг друга, поэтому потоки спят до stop().
+class SharedQueueExecutor : public Executor {
+public:
+    void post(coroutine_handle<> handle) override {
+        bool wake;
+        {
+            lock_guard<mutex> lock(m);
+            ready.push_back(handle);
+            wake = sleeping > 0;
+        }
+        if (wake) {
+            cv.notify_one();
+        }
+    }
+
+    void run() override {
+        unique_lock<mutex> lock(m);
+        while (true) {
+            if (ready.empty()) {
+                if (stopped) {
+                    return;
+                }
+                ++sleeping;
+                cv.wait(lock, [this]() { return stopped || !ready.empty(); });
+                --sleeping;
+                continue;
+            }
+            coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+        }
+    }
+
+    void stop() override {
+        {
+            lock_guard<mutex> lock(m);
+            stopped = true;
+        }
+        cv.notify_all();
+    }
+
+private:
+    mutex m;
+    condition_variable cv;
+    deque<coroutine_handle<>> ready;
+    int sleeping = 0;
+    bool stopped = false;
+};
+
+// Сопрограмма без результата: стартует по первому resume и сама освобождает кадр
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() {
+            return {coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            terminate();
+        }
+    };
+
+    coroutine_handle<promise_type> handle;
+};
+
+// Ожидающая сопрограмма; узел хранится в awaiter-е, то есть в ее кадре, и память не выделяется
+struct CoroWaiter {
+    coroutine_handle<> handle;
+    Executor* executor;
+    CoroWaiter* next = nullptr;
+};
+
+// Очередь FIFO ожидающих сопрограмм
+class CoroWaiterQueue {
+public:
+    bool empty() const {
+        return head == nullptr;
+    }
+
+    void push(CoroWaiter* waiter) {
+        waiter->next = nullptr;
+        (tail ? tail->next : head) = waiter;
+        tail = waiter;
+    }
+
+    CoroWaiter* pop() {
+        CoroWaiter* waiter = head;
+        if (waiter) {
+            head = waiter->next;
+            if (!head) {
+                tail = nullptr;
+            }
+        }
+        return waiter;
+    }
+
+    // Забрать всю очередь
+    CoroWaiter* takeAll() {
+        CoroWaiter* all = head;
+        head = tail = nullptr;
+        return all;
+    }
+
+private:
+    CoroWaiter* head = nullptr;
+    CoroWaiter* tail = nullptr;
+};
+
+// Возобновление сопрограммы в ее исполнителе. Поля читаются до post(): после него
+// сопрограмма может продолжиться в другом потоке, и узел перестанет существовать.
+inline void resumeWaiter(CoroWaiter* waiter) {
+    Executor* executor = waiter->executor;
+    executor->post(waiter->handle);
 }
 
-// Функция для тестирования мьютекса
-std::chrono::duration<double> testMutex(int numThreads) {
-    mutex mutex; // Мьютекс для синхронизации доступа к общему ресурсу
-    auto startTime = chrono::high_resolution_clock::now(); // Засекаем время начала
+// Асинхронный мьютекс: co_await mutex.lock(executor) приостанавливает сопрограмму,
+// а не поток. unlock() передает владение первому ожидающему напрямую.
+class AsyncMutex {
+public:
+    auto lock(Executor& executor) {
+        struct Awaiter {
+            AsyncMutex& mutex;
+            CoroWaiter waiter;
 
-    vector<thread> threads; // Вектор для хранения потоков
-    for (int i = 0; i < numThreads; ++i) {
-        threads.emplace_back([i, &mutex]() {
-            lock_guard<std::mutex> lock(mutex); // Блокируем мьютекс
-            char randomChar = generateRandomChar(); // Генерируем случайный символ
-            cout << "Поток " << i + 1 << ": Случайный символ ASCII: " << randomChar << endl; // Выводим символ
-        });
+            bool await_ready() {
+                return false;
+            }
+
+            // false - мьютекс свободен и захвачен, сопрограмма продолжается сразу
+            bool await_suspend(coroutine_handle<> handle) {
+                waiter.handle = handle;
+                lock_guard<TtasSpinLock> guard(mutex.stateLock);
+                if (!mutex.locked) {
+                    mutex.locked = true;
+                    return false;
+                }
+                mutex.waiters.push(&waiter);
+                return true;
+            }
+
+            void await_resume() {}
+        };
+        return Awaiter{*this, {{}, &executor}};
     }
 
-    for (auto& t : threads) {
-        t.join(); // Дожидаемся завершения всех потоков
+    void unlock() {
+        CoroWaiter* next;
+        {
+            lock_guard<TtasSpinLock> guard(stateLock);
+            next = waiters.pop();
+            if (!next) {
+                locked = false;
+            }
+        }
+        if (next) {
+            resumeWaiter(next); // locked остается true: мьютекс уже принадлежит next
+        }
+    }
+
+private:
+    TtasSpinLock stateLock; // Защищает состояние; удерживается на несколько инструкций
+    bool locked = false;
+    CoroWaiterQueue waiters;
+};
+
+// Асинхронный счетный семафор; release() отдает разрешение ожидающему напрямую
+class AsyncSemaphore {
+public:
+    explicit AsyncSemaphore(int permits) : count(permits) {}
+
+    auto acquire(Executor& executor) {
+        struct Awaiter {
+            AsyncSemaphore& semaphore;
+            CoroWaiter waiter;
+
+            bool await_ready() {
+                return false;
+            }
+
+            bool await_suspend(coroutine_handle<> handle) {
+                waiter.handle = handle;
+                lock_guard<TtasSpinLock> guard(semaphore.stateLock);
+                if (semaphore.count > 0) {
+                    --semaphore.count;
+                    return false;
+                }
+                semaphore.waiters.push(&waiter);
+                return true;
+            }
+
+            void await_resume() {}
+        };
+        return Awaiter{*this, {{}, &executor}};
+    }
+
+    void release() {
+        CoroWaiter* next;
+        {
+            lock_guard<TtasSpinLock> guard(stateLock);
+            next = waiters.pop();
+            if (!next) {
+                ++count;
+            }
+        }
+        if (next) {
+            resumeWaiter(next);
+        }
+    }
+
+private:
+    TtasSpinLock stateLock;
+    int count;
+    CoroWaiterQueue waiters;
+};
+
+// Событие с ручным сбросом: co_await event.wait(executor) ждет set(); аналог монитора
+// с флагом готовности, где notify_all будит всех ожидающих
+class AsyncEvent {
+public:
+    auto wait(Executor& executor) {
+        struct Awaiter {
+            AsyncEvent& event;
+            CoroWaiter waiter;
+
+            bool await_ready() {
+                return event.isSet.load(memory_order_acquire);
+            }
+
+            bool await_suspend(coroutine_handle<> handle) {
+                waiter.handle = handle;
+                lock_guard<TtasSpinLock> guard(event.stateLock);
+                if (event.isSet.load(memory_order_relaxed)) {
+                    return false;
+                }
+                event.waiters.push(&waiter);
+                return true;
+            }
+
+            void await_resume() {}
+        };
+        return Awaiter{*this, {{}, &executor}};
+    }
+
+    void set() {
+        CoroWaiter* all;
+        {
+            lock_guard<TtasSpinLock> guard(stateLock);
+            isSet.store(true, memory_order_release);
+            all = waiters.takeAll();
+        }
+        while (all) {
+            CoroWaiter* next = all->next;
+            resumeWaiter(all);
+            all = next;
+        }
+    }
+
+    void reset() {
+        isSet.store(false, memory_order_relaxed);
     }
 
-    auto endTime = std::chrono::high_resolution_clock::now(); // Засекаем время окончания
-    return endTime - startTime; // Возвращаем время выполнения
+private:
+    TtasSpinLock stateLock;
+    atomic<bool> isSet{false};
+    CoroWaiterQueue waiters;
+};
+
+// Единый интерфейс захвата для шаблонных тестов
+inline auto acquireAsync(AsyncMutex& mutex, Executor& executor) {
+    return mutex.lock(executor);
 }
 
-// Функция для тестирования семафора
-std::chrono::duration<double> testSemaphore(int numThreads) {
-    vector<thread> threads; // Вектор для хранения потоков
-    mutex mutex; // Мьютекс для синхронизации доступа к общему ресурсу
-    condition_variable cv; // Условная переменная для ожидания
-    int count = 0; // Счетчик потоков, ожидающих доступа
-    auto startTime = std::chrono::high_resolution_clock::now(); // Засекаем время начала
-
-    for (int i = 0; i < numThreads; ++i) {
-        threads.emplace_back([i, &mutex, &cv, &count, numThreads]() {
-            unique_lock<std::mutex> lock(mutex); // Блокируем мьютекс
-            cv.wait(lock, [&count, numThreads]() { return count < numThreads / 2; }); // Ожидаем, пока счетчик меньше половины потоков
-            ++count; // Увеличиваем счетчик
-            char randomChar = generateRandomChar(); // Генерируем случайный символ
-            cout << "Поток " << i + 1 << ": Случайный символ ASCII: " << randomChar << endl; // Выводим символ
-            --count; // Уменьшаем счетчик
-            cv.notify_one(); // Уведомляем один из ожидающих потоков
-        });
+inline auto acquireAsync(AsyncSemaphore& semaphore, Executor& executor) {
+    return semaphore.acquire(executor);
+}
+
+inline void releaseAsync(AsyncMutex& mutex) {
+    mutex.unlock();
+}
+
+inline void releaseAsync(AsyncSemaphore& semaphore) {
+    semaphore.release();
+}
+
+// Статистика по серии измерений
+struct BenchStats {
+    double min = 0;
+    double median = 0;
+    double p99 = 0;
+    double mean = 0;
+    double stddev = 0;
+};
+
+// Перцентиль методом ближайшего ранга по отсортированной выборке
+double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
     }
+    size_t rank = static_cast<size_t>(ceil(p / 100.0 * sorted.size()));
+    rank = min(max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
 
-    for (auto& t : threads) {
-        t.join(); // Дожидаемся завершения всех потоков
+// Расчет min/median/p99/mean/stddev по серии измерений
+BenchStats computeStats(vector<double> samples) {
+    BenchStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats.min = samples.front();
+    stats.median = (n % 2 == 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    stats.p99 = percentile(samples, 99);
+
+    double sum = 0;
+    for (double s : samples) {
+        sum += s;
     }
+    stats.mean = sum / n;
 
-    auto endTime = std::chrono::high_resolution_clock::now(); // Засекаем время окончания
-    return endTime - startTime; // Возвращаем время выполнения
+    double sq = 0;
+    for (double s : samples) {
+        sq += (s - stats.mean) * (s - stats.mean);
+    }
+    stats.stddev = n > 1 ? sqrt(sq / (n - 1)) : 0; // Выборочное стандартное отклонение
+    return stats;
 }
 
-// Функция для тестирования семафора с ограничением на 1 поток
-std::chrono::duration<double> testSemaphoreSlim(int numThreads) {
-    vector<thread> threads; // Вектор для хранения потоков
-    mutex mutex; // Мьютекс для синхронизации доступа к общему ресурсу
-    condition_variable cv; // Условная переменная для ожидания
-    bool locked = false; // Флаг, указывающий, занят ли семафор
-    auto startTime = std::chrono::high_resolution_clock::now(); // Засекаем время начала
+// ---------------------------------------------------------------------------
+// Модель нагрузки: работа внутри и вне критической секции, число блокировок,
+// распределение выбора блокировки и доля чтений
+// ---------------------------------------------------------------------------
 
-    for (int i = 0; i < numThreads; ++i) {
-        threads.emplace_back([i, &mutex, &cv, &locked]() {
-            unique_lock<std::mutex> lock(mutex); // Блокируем мьютекс
-            cv.wait(lock, [&locked]() { return !locked; }); // Ожидаем, пока семафор не будет свободен
-            locked = true; // Блокируем семафор
-            char randomChar = generateRandomChar(); // Генерируем случайный символ
-            cout << "Поток " << i + 1 << ": Случайный символ ASCII: " << randomChar << endl; // Выводим символ
-            locked = false; // Освобождаем семафор
-            cv.notify_one(); // Уведомляем один из ожидающих потоков
-        });
+// Цикл с барьером компилятора: его нельзя ни выбросить, ни свернуть в одну операцию
+inline void spinLoops(uint64_t loops) {
+    for (uint64_t i = 0; i < loops; ++i) {
+        asm volatile("" ::: "memory");
+    }
+}
+
+// Итераций spinLoops за наносекунду; калибруется один раз при первом обращении.
+// Берется лучший из нескольких замеров: вытеснение потока только удлиняет замер.
+double spinLoopsPerNs() {
+    static const double rate = []() {
+        constexpr uint64_t loops = 1 << 22;
+        double bestNs = numeric_limits<double>::max();
+        for (int attempt = 0; attempt < 5; ++attempt) {
+            auto start = chrono::steady_clock::now();
+            spinLoops(loops);
+            bestNs = min(bestNs, chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+        }
+        return loops / bestNs;
+    }();
+    return rate;
+}
+
+// Параметры модели нагрузки из командной строки
+struct WorkloadConfig {
+    double csNs = 0;         // Работа внутри критической секции, нс
+    double thinkNs = 0;      // Работа вне критической секции между захватами, нс
+    int locks = 1;           // Число независимых экземпляров примитива
+    double zipf = 0;         // Показатель распределения Ципфа при выборе экземпляра (0 - равномерно)
+    double readFraction = 0; // Доля операций, которые только читают защищенные данные
+};
+
+// Модель, подготовленная к запуску: длительности в итерациях spinLoops и таблица распределения
+class Workload {
+public:
+    explicit Workload(const WorkloadConfig& config)
+        : csLoops(toLoops(config.csNs)), thinkLoops(toLoops(config.thinkNs)), locks(config.locks),
+          readFraction(config.readFraction) {
+        if (config.zipf > 0 && locks > 1) {
+            // Вероятность экземпляра k пропорциональна 1 / (k + 1)^zipf
+            cdf.resize(locks);
+            double sum = 0;
+            for (int k = 0; k < locks; ++k) {
+                sum += 1.0 / pow(k + 1, config.zipf);
+                cdf[k] = sum;
+            }
+            for (double& c : cdf) {
+                c /= sum;
+            }
+        }
     }
 
-    for (auto& t : threads) {
-        t.join(); // Дожидаемся завершения всех потоков
+    int lockCount() const {
+        return locks;
     }
 
-    auto endTime = std::chrono::high_resolution_clock::now(); // Засекаем время окончания
-    return endTime - startTime; // Возвращаем время выполнения
+    // Номер экземпляра для очередной операции
+    int pickLock(Xoshiro256& rng) const {
+        if (locks == 1) {
+            return 0;
+        }
+        if (cdf.empty()) {
+            return static_cast<int>(rng.nextBelow(locks));
+        }
+        auto it = lower_bound(cdf.begin(), cdf.end(), rng.nextDouble());
+        return min(static_cast<int>(it - cdf.begin()), locks - 1);
+    }
+
+    // Будет ли очередная операция чтением
+    bool pickRead(Xoshiro256& rng) const {
+        return readFraction > 0 && rng.nextDouble() < readFraction;
+    }
+
+    void criticalSection() const {
+        spinLoops(csLoops);
+    }
+
+    void think() const {
+        spinLoops(thinkLoops);
+    }
+
+private:
+    static uint64_t toLoops(double ns) {
+        return ns > 0 ? static_cast<uint64_t>(ns * spinLoopsPerNs() + 0.5) : 0;
+    }
+
+    uint64_t csLoops;
+    uint64_t thinkLoops;
+    int locks;
+    double readFraction;
+    vector<double> cdf; // Накопленные вероятности экземпляров; пусто - равномерный выбор
+};
+
+// Экземпляр примитива вместе с защищаемыми им данными; каждый в своей строке кэша
+template <typename Primitive>
+struct alignas(64) Guarded {
+    template <typename... Args>
+    explicit Guarded(const Args&... args) : primitive(args...) {}
+
+    Primitive primitive;
+    uint64_t value = 0; // Защищаемые данные
+};
+
+// Набор экземпляров примитива; args передаются конструктору каждого
+template <typename Primitive, typename... Args>
+vector<unique_ptr<Guarded<Primitive>>> makeGuarded(int count, const Args&... args) {
+    vector<unique_ptr<Guarded<Primitive>>> guarded;
+    for (int k = 0; k < count; ++k) {
+        guarded.push_back(make_unique<Guarded<Primitive>>(args...));
+    }
+    return guarded;
 }
 
-// Функция для тестирования SpinWait
-std::chrono::duration<double> testSpinWait(int numThreads) {
-    vector<thread> threads; // Вектор для хранения потоков
-    auto startTime = std::chrono::high_resolution_clock::now(); // Засекаем время начала
+// ---------------------------------------------------------------------------
+// Тесты примитивов
+// ---------------------------------------------------------------------------
 
-    for (int i = 0; i < numThreads; ++i) {
-        threads.emplace_back([i]() {
-            for (int j = 0; j < 1000000; ++j) {} // Имитация работы
-            char randomChar = generateRandomChar(); // Генерируем случайный символ
-            cout << "Поток " << i + 1 << ": Случайный символ ASCII: " << randomChar << endl; // Выводим символ
-        });
+// Параметры одного запуска теста
+struct TestParams {
+    int numThreads = 1; // Количество потоков
+    int iterations = 1; // Количество итераций на поток
+    int permits = 0;    // Разрешений у семафора (0 - половина потоков, но не меньше 1)
+    int phases = 100;   // Количество фаз в тестах барьеров
+    WorkloadConfig workload; // Модель нагрузки
+    int tasks = 100000;      // Количество задач в тестах сопрограмм
+    int waiterThreads = 10000; // Количество потоков ОС в тесте потоков на ожидающего
+};
+
+// Ошибки прогона (нарушение взаимного исключения, нехватка потоков); при ненулевом
+// счетчике бенчмарк завершается с кодом 1
+atomic<int> benchErrors{0};
+
+// Число разрешений семафора для запуска
+int semaphorePermits(const TestParams& params) {
+    return params.permits > 0 ? params.permits : max(1, params.numThreads / 2);
+}
+
+// Статистика одного потока; выравнивание исключает ложное разделение строк кэша
+struct alignas(64) ThreadStats {
+    double maxWaitNs = 0; // Самое долгое ожидание захвата
+    uint64_t writes = 0;  // Выполнено операций записи
+    uint64_t readSum = 0; // Сумма прочитанных значений; не дает выбросить чтения
+    uint64_t readRetries = 0; // Повторы оптимистичных чтений
+};
+
+// Дополнительная именованная метрика запуска, например max_wait_ns
+struct Metric {
+    string name;
+    double value;
+};
+
+// Результат одного запуска теста
+struct RunResult {
+    chrono::duration<double> elapsed; // Время синхронной фазы
+    vector<Metric> metrics;           // Метрики, которые измеряет конкретный тест
+};
+
+// Захват примитива с замером времени ожидания
+template <typename Acquire>
+void timedAcquire(ThreadStats& stats, Acquire&& acquire) {
+    auto start = chrono::steady_clock::now();
+    acquire();
+    double waitNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    stats.maxWaitNs = max(stats.maxWaitNs, waitNs);
+}
+
+// Максимальное ожидание среди всех потоков
+double maxWait(const vector<ThreadStats>& stats) {
+    double result = 0;
+    for (const auto& s : stats) {
+        result = max(result, s.maxWaitNs);
     }
+    return result;
+}
 
-    for (auto& t : threads) {
-        t.join(); // Дожидаемся завершения всех потоков
+// Доступ к защищенным данным в критической секции. Обращения relaxed-атомарные,
+// чтобы семафоры с несколькими разрешениями не давали гонку данных; на x86 это
+// обычные mov. При настоящем взаимном исключении записи не теряются.
+inline void touchGuarded(uint64_t& value, bool read, ThreadStats& stats) {
+    atomic_ref<uint64_t> data(value);
+    if (read) {
+        stats.readSum += data.load(memory_order_relaxed);
+    } else {
+        data.store(data.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        ++stats.writes;
+    }
+}
+
+// Цикл одного потока в тестах взаимного исключения: выбор экземпляра, захват
+// с замером ожидания, сообщение и работа в критической секции, освобождение,
+// работа вне секции
+template <typename Primitive, typename Acquire, typename Release>
+void runLockLoop(int i, const TestParams& params, const Workload& workload,
+                 vector<unique_ptr<Guarded<Primitive>>>& guarded, ThreadStats& stats,
+                 Acquire&& acquire, Release&& release) {
+    Xoshiro256& rng = threadRandom();
+    for (int k = 0; k < params.iterations; ++k) {
+        Guarded<Primitive>& g = *guarded[workload.pickLock(rng)];
+        bool read = workload.pickRead(rng);
+        timedAcquire(stats, [&]() { acquire(g.primitive); }); // Захватываем примитив
+        char randomChar = generateRandomChar(); // Генерируем случайный символ
+        AsyncLog::instance().write(formatRandomChar, CharMessage{i + 1, randomChar}); // Выводим символ
+        workload.criticalSection();
+        touchGuarded(g.value, read, stats);
+        release(g.primitive); // Освобождаем примитив
+        workload.think();
+    }
+}
+
+// Проверка взаимного исключения: каждая запись должна дойти до защищенных данных
+template <typename Primitive>
+void checkExclusion(const vector<unique_ptr<Guarded<Primitive>>>& guarded,
+                    const vector<ThreadStats>& stats) {
+    uint64_t stored = 0;
+    uint64_t written = 0;
+    for (const auto& g : guarded) {
+        stored += g->value;
+    }
+    for (const auto& s : stats) {
+        written += s.writes;
+    }
+    if (stored != written) {
+        cerr << "Нарушено взаимное исключение: потеряно записей " << written - stored << " из " << written << endl;
+        benchErrors.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+// Функция для тестирования взаимоисключающей блокировки (std::mutex или спинлока)
+template <typename Lock>
+RunResult testLock(WorkerPool& pool, const TestParams& params) {
+    Workload workload(params.workload);
+    auto locks = makeGuarded<Lock>(workload.lockCount()); // Блокировки и защищаемые ими данные
+    vector<ThreadStats> stats(params.numThreads);
+
+    auto elapsed = pool.run(params.numThreads, [&](int i) {
+        runLockLoop(i, params, workload, locks, stats[i],
+                    [](Lock& lock) { lock.lock(); }, [](Lock& lock) { lock.unlock(); });
+    });
+    checkExclusion(locks, stats);
+    return {elapsed, {{"max_wait_ns", maxWait(stats)}}};
+}
+
+// Функция для тестирования семафора
+template <typename Semaphore>
+RunResult testSemaphore(WorkerPool& pool, const TestParams& params) {
+    Workload workload(params.workload);
+    // Семафоры, ограничивающие число потоков в секции
+    auto semaphores = makeGuarded<Semaphore>(workload.lockCount(), semaphorePermits(params));
+    vector<ThreadStats> stats(params.numThreads);
+
+    auto elapsed = pool.run(params.numThreads, [&](int i) {
+        runLockLoop(i, params, workload, semaphores, stats[i],
+                    [](Semaphore& semaphore) { semaphore.acquire(); }, // Занимаем разрешение
+                    [](Semaphore& semaphore) { semaphore.release(); }); // Возвращаем разрешение
+    });
+    if (semaphorePermits(params) == 1) {
+        checkExclusion(semaphores, stats);
     }
+    return {elapsed, {{"max_wait_ns", maxWait(stats)}}};
+}
 
-    auto endTime = std::chrono::high_resolution_clock::now(); // Засекаем время окончания
-    return endTime - startTime; // Возвращаем время выполнения
+// Чтение под блокировкой читателей с замером ожидания
+template <typename RwLock, typename Read>
+void sharedRead(RwLock& lock, ThreadStats& stats, Read&& read) {
+    timedAcquire(stats, [&lock]() { lock.lock_shared(); });
+    read();
+    lock.unlock_shared();
 }
 
-// Функция для тестирования барьера
-std::chrono::duration<double> testBarrier(int numThreads) {
-    vector<thread> threads; // Вектор для хранения потоков
-    mutex mutex; // Мьютекс для синхронизации доступа к общему ресурсу
-    condition_variable cv; // Условная переменная для ожидания
-    int count = 0; // Счетчик потоков, достигших барьера
-    auto startTime = std::chrono::high_resolution_clock::now(); // Засекаем время начала
+// Seqlock читает без захвата; ожидание здесь - это повторы чтения
+template <typename Read>
+void sharedRead(SeqLock& lock, ThreadStats& stats, Read&& read) {
+    stats.readRetries += lock.read(read);
+}
+
+// Функция для тестирования блокировки читателей-писателей: доля чтений задается
+// моделью нагрузки. Сообщение выводится после чтения, так как оптимистичное
+// чтение может выполняться несколько раз.
+template <typename RwLock>
+RunResult testRwLock(WorkerPool& pool, const TestParams& params) {
+    Workload workload(params.workload);
+    auto locks = makeGuarded<RwLock>(workload.lockCount()); // Блокировки и защищаемые ими данные
+    vector<ThreadStats> stats(params.numThreads);
 
-    for (int i = 0; i < numThreads; ++i) {
-        threads.emplace_back([i, &mutex, &cv, &count, numThreads]() {
-            unique_lock<std::mutex> lock(mutex); // Блокируем мьютекс
-            cout << "Поток " << i + 1 << " достиг барьера" << endl; // Выводим сообщение о достижении барьера
-            ++count; // Увеличиваем счетчик
-            if (count == numThreads) {
-                cv.notify_all(); // Если все потоки достигли барьера, уведомляем их
+    auto elapsed = pool.run(params.numThreads, [&](int i) {
+        Xoshiro256& rng = threadRandom();
+        for (int k = 0; k < params.iterations; ++k) {
+            Guarded<RwLock>& g = *locks[workload.pickLock(rng)];
+            if (workload.pickRead(rng)) {
+                sharedRead(g.primitive, stats[i], [&]() {
+                    workload.criticalSection();
+                    touchGuarded(g.value, true, stats[i]);
+                });
+                char randomChar = generateRandomChar(); // Генерируем случайный символ
+                AsyncLog::instance().write(formatRandomChar, CharMessage{i + 1, randomChar}); // Выводим символ
             } else {
-                cv.wait(lock, [&count, numThreads]() { return count == numThreads; }); // Ожидаем, пока все потоки достигнут барьера
+                timedAcquire(stats[i], [&g]() { g.primitive.lock(); }); // Захватываем на запись
+                char randomChar = generateRandomChar(); // Генерируем случайный символ
+                AsyncLog::instance().write(formatRandomChar, CharMessage{i + 1, randomChar}); // Выводим символ
+                workload.criticalSection();
+                touchGuarded(g.value, false, stats[i]);
+                g.primitive.unlock();
             }
+            workload.think();
+        }
+    });
+    checkExclusion(locks, stats);
+    uint64_t retries = 0;
+    for (const auto& s : stats) {
+        retries += s.readRetries;
+    }
+    vector<Metric> metrics = {{"max_wait_ns", maxWait(stats)}};
+    if constexpr (is_same_v<RwLock, SeqLock>) {
+        metrics.push_back({"read_retries", static_cast<double>(retries)});
+    }
+    return {elapsed, metrics};
+}
+
+// Функция для тестирования SpinWait: та же работа без синхронизации, нижняя граница для остальных тестов
+RunResult testSpinWait(WorkerPool& pool, const TestParams& params) {
+    Workload workload(params.workload);
+    auto elapsed = pool.run(params.numThreads, [&workload, &params](int i) {
+        for (int k = 0; k < params.iterations; ++k) {
             char randomChar = generateRandomChar(); // Генерируем случайный символ
-            cout << "Поток " << i + 1 << " продолжает выполнение: " << randomChar << endl; // Выводим символ
-        });
+            AsyncLog::instance().write(formatRandomChar, CharMessage{i + 1, randomChar}); // Выводим символ
+            workload.criticalSection(); // Имитация работы
+            workload.think();
+        }
+    });
+    return {elapsed, {}}; // Ожидание захвата здесь не измеряется
+}
+
+// Функция для тестирования барьера: params.phases фаз подряд на одном барьере.
+// Латентность эпизода - от прихода последнего потока до ухода последнего,
+// так что полезная работа между фазами в нее не попадает. Работа фазы -
+// params.iterations раз по длине критической секции и времени вне ее.
+template <typename Barrier>
+RunResult testBarrier(WorkerPool& pool, const TestParams& params) {
+    Workload workload(params.workload);
+    Barrier barrier(params.numThreads);
+    // Моменты прихода к барьеру и выхода из него, отдельно для каждого потока
+    vector<vector<int64_t>> arrive(params.numThreads, vector<int64_t>(params.phases));
+    vector<vector<int64_t>> depart(params.numThreads, vector<int64_t>(params.phases));
+    auto nowNs = []() {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    };
+
+    auto elapsed = pool.run(params.numThreads, [&barrier, &arrive, &depart, &nowNs, &workload, &params](int i) {
+        for (int phase = 0; phase < params.phases; ++phase) {
+            arrive[i][phase] = nowNs();
+            barrier.wait(i); // Ожидаем, пока все потоки достигнут барьера
+            depart[i][phase] = nowNs();
+            for (int k = 0; k < params.iterations; ++k) {
+                char randomChar = generateRandomChar(); // Генерируем случайный символ
+                AsyncLog::instance().write(formatContinue, CharMessage{i + 1, randomChar}); // Выводим символ
+                workload.criticalSection();
+                workload.think();
+            }
+        }
+    });
+
+    vector<double> episodes(params.phases);
+    for (int phase = 0; phase < params.phases; ++phase) {
+        int64_t lastArrive = 0;
+        int64_t lastDepart = 0;
+        for (int i = 0; i < params.numThreads; ++i) {
+            lastArrive = max(lastArrive, arrive[i][phase]);
+            lastDepart = max(lastDepart, depart[i][phase]);
+        }
+        episodes[phase] = static_cast<double>(lastDepart - lastArrive);
     }
+    BenchStats episodeStats = computeStats(episodes);
+    return {elapsed, {{"phase_median_ns", episodeStats.median}, {"phase_p99_ns", episodeStats.p99}}};
+}
 
-    for (auto& t : threads) {
-        t.join(); // Дожидаемся завершения всех потоков
+// Источники случайных символов для теста пропускной способности
+enum class RandomSource {
+    Mt19937,    // mt19937 и uniform_int_distribution на каждый символ (как в исходной версии, но на поток)
+    Xoshiro,    // xoshiro256** и nextBelow на каждый символ
+    FillScalar, // Пакетное заполнение PrintableFiller, скалярная версия
+    Fill,       // Пакетное заполнение PrintableFiller с выбором AVX2 во время выполнения
+};
+
+// Функция для тестирования пропускной способности генерации случайных символов:
+// каждый поток params.iterations раз заполняет свой буфер randomBufferBytes байт
+template <RandomSource Source>
+RunResult testRandom(WorkerPool& pool, const TestParams& params) {
+    constexpr size_t randomBufferBytes = 64 * 1024;
+    vector<vector<char>> buffers(params.numThreads, vector<char>(randomBufferBytes));
+    vector<PrintableFiller> fillers;
+    vector<Xoshiro256> streams;
+    vector<mt19937> mersenne;
+    for (int i = 0; i < params.numThreads; ++i) {
+        streams.push_back(RandomStreams::global().next());
+        fillers.emplace_back(streams.back());
+        mersenne.emplace_back(static_cast<uint32_t>(streams.back()()));
     }
+    atomic<uint64_t> checksum{0}; // Не дает компилятору выбросить сгенерированные данные
 
-    auto endTime = std::chrono::high_resolution_clock::now(); // Засекаем время окончания
-    return endTime - startTime; // Возвращаем время выполнения
+    auto elapsed = pool.run(params.numThreads, [&](int i) {
+        char* buffer = buffers[i].data();
+        for (int k = 0; k < params.iterations; ++k) {
+            if constexpr (Source == RandomSource::Mt19937) {
+                uniform_int_distribution<> dis(32, 126);
+                for (size_t j = 0; j < randomBufferBytes; ++j) {
+                    buffer[j] = static_cast<char>(dis(mersenne[i]));
+                }
+            } else if constexpr (Source == RandomSource::Xoshiro) {
+                for (size_t j = 0; j < randomBufferBytes; ++j) {
+                    buffer[j] = static_cast<char>(32 + streams[i].nextBelow(95));
+                }
+            } else if constexpr (Source == RandomSource::FillScalar) {
+                fillers[i].fillScalar(buffer, randomBufferBytes);
+            } else {
+                fillers[i].fill(buffer, randomBufferBytes);
+            }
+        }
+        checksum.fetch_add(static_cast<unsigned char>(buffer[randomBufferBytes - 1]), memory_order_relaxed);
+    });
+    double bytes = static_cast<double>(randomBufferBytes) * params.iterations * params.numThreads;
+    return {elapsed, {{"mb_per_s", bytes / elapsed.count() / 1e6}}};
 }
 
-// Функция для тестирования спинлока
-std::chrono::duration<double> testSpinLock(int numThreads) {
-    vector<thread> threads; // Вектор для хранения потоков
-    atomic<bool> spinLock(false); // Атомарный флаг для спинлока
-    auto startTime = std::chrono::high_resolution_clock::now(); // Засекаем время начала
+// Монитор из std::mutex и std::condition_variable
+struct StdMonitor {
+    void lock() {
+        m.lock();
+    }
 
-    for (int i = 0; i < numThreads; ++i) {
-        threads.emplace_back([i, &spinLock]() {
-            while (spinLock.exchange(true, memory_order_acquire)) {
-                // Spin until lock is acquired
-            }
-            char randomChar = generateRandomChar(); // Генерируем случайный символ
-            cout << "Поток " << i + 1 << ": Случайный символ ASCII: " << randomChar << endl; // Выводим символ
-            spinLock.store(false, memory_order_release); // Освобождаем спинлок
-        });
+    void unlock() {
+        m.unlock();
     }
 
-    for (auto& t : threads) {
-        t.join(); // Дожидаемся завершения всех потоков
+    template <typename Predicate>
+    void wait(Predicate pred) {
+        unique_lock<mutex> lock(m, adopt_lock);
+        cv.wait(lock, pred);
+        lock.release(); // Мьютекс остается захваченным
+    }
+
+    void notifyAll() {
+        cv.notify_all();
+    }
+
+    mutex m;
+    condition_variable cv;
+};
+
+// Монитор в два байта поверх парковки
+struct ParkingMonitor {
+    void lock() {
+        m.lock();
+    }
+
+    void unlock() {
+        m.unlock();
+    }
+
+    template <typename Predicate>
+    void wait(Predicate pred) {
+        cv.wait(m, pred);
+    }
+
+    void notifyAll() {
+        cv.notifyAll();
     }
 
-    auto endTime = std::chrono::high_resolution_clock::now(); // Засекаем время окончания
-    return endTime - startTime; // Возвращаем время выполнения
+    ByteLock m;
+    ParkingCondition cv;
+};
+
+// Монитор и флаг готовности, который он защищает
+template <typename Monitor>
+struct MonitorState {
+    Monitor monitor;
+    bool ready = false; // Флаг, указывающий, готовы ли потоки
+};
+
+// Вход в монитор: захват мьютекса и ожидание флага готовности
+template <typename Monitor>
+void enterMonitor(MonitorState<Monitor>& state) {
+    state.monitor.lock(); // Блокируем мьютекс
+    state.monitor.wait([&state]() { return state.ready; }); // Ожидаем флаг
+}
+
+template <typename Monitor>
+void exitMonitor(MonitorState<Monitor>& state) {
+    state.monitor.unlock();
 }
 
 // Функция для тестирования монитора
-std::chrono::duration<double> testMonitor(int numThreads) {
-    vector<thread> threads; // Вектор для хранения потоков
-    mutex mutex; // Мьютекс для синхронизации доступа к общему ресурсу
-    condition_variable cv; // Условная переменная для ожидания
-    bool ready = false; // Флаг, указывающий, готовы ли потоки
-    auto startTime = std::chrono::high_resolution_clock::now(); // Засекаем время начала
+// Роль уведомляющего потока (в исходной версии - main) выполняет поток 0:
+// он открывает все мониторы, остальные ждут флаг на каждом входе
+template <typename Monitor>
+RunResult testMonitor(WorkerPool& pool, const TestParams& params) {
+    Workload workload(params.workload);
+    auto monitors = makeGuarded<MonitorState<Monitor>>(workload.lockCount());
+    vector<ThreadStats> stats(params.numThreads);
 
-    for (int i = 0; i < numThreads; ++i) {
-        threads.emplace_back([i, &mutex, &cv, &ready]() {
-            unique_lock<std::mutex> lock(mutex); // Блокируем мьютекс
-            cv.wait(lock, [&ready]() { return ready; }); // Ожидаем, пока флаг не станет истинным
-            char randomChar = generateRandomChar(); // Генерируем случайный символ
-            cout << "Поток " << i + 1 << ": Случайный символ ASCII: " << randomChar << endl; // Выводим символ
-        });
+    auto elapsed = pool.run(params.numThreads, [&](int i) {
+        if (i == 0) {
+            for (auto& g : monitors) {
+                g->primitive.monitor.lock();
+                g->primitive.ready = true; // Устанавливаем флаг в истину
+                g->primitive.monitor.notifyAll(); // Уведомляем все потоки
+                g->primitive.monitor.unlock();
+            }
+        }
+        runLockLoop(i, params, workload, monitors, stats[i], enterMonitor<Monitor>, exitMonitor<Monitor>);
+    });
+    checkExclusion(monitors, stats);
+    return {elapsed, {{"max_wait_ns", maxWait(stats)}}};
+}
+
+// Задача теста сопрограмм: то же, что цикл потока в тестах взаимного исключения,
+// но ожидание захвата приостанавливает сопрограмму. С waitStart задача сначала
+// ждет события, как поток в тесте монитора ждет флага готовности.
+// Генератор берется заново после каждого co_await: задача могла переехать в другой поток.
+template <typename Primitive>
+DetachedTask coroTask(int task, const TestParams& params, const Workload& workload,
+                      vector<unique_ptr<Guarded<Primitive>>>& guarded, ThreadStats& stats, Executor& executor,
+                      AsyncEvent* start, atomic<int>& remaining) {
+    if (start) {
+        co_await start->wait(executor);
     }
+    for (int k = 0; k < params.iterations; ++k) {
+        Guarded<Primitive>& g = *guarded[workload.pickLock(threadRandom())];
+        bool read = workload.pickRead(threadRandom());
+        auto waitStart = chrono::steady_clock::now();
+        co_await acquireAsync(g.primitive, executor); // Захватываем примитив
+        double waitNs = chrono::duration<double, nano>(chrono::steady_clock::now() - waitStart).count();
+        stats.maxWaitNs = max(stats.maxWaitNs, waitNs);
+        char randomChar = generateRandomChar(); // Генерируем случайный символ
+        AsyncLog::instance().write(formatRandomChar, CharMessage{task + 1, randomChar}); // Выводим символ
+        workload.criticalSection();
+        touchGuarded(g.value, read, stats);
+        releaseAsync(g.primitive); // Освобождаем примитив
+        workload.think();
+    }
+    if (remaining.fetch_sub(1, memory_order_acq_rel) == 1) {
+        executor.stop(); // Последняя задача завершает работу исполнителя
+    }
+}
+
+// Функция для тестирования примитивов сопрограмм: params.tasks задач на params.numThreads
+// потоках. Один поток - исполнитель без синхронизации, несколько - общая очередь.
+// Создание задач входит в замер, как создание потоков в testThreadPerWaiter.
+template <typename Primitive, bool WaitStart>
+RunResult testCoro(WorkerPool& pool, const TestParams& params) {
+    Workload workload(params.workload);
+    vector<unique_ptr<Guarded<Primitive>>> guarded;
+    if constexpr (is_same_v<Primitive, AsyncSemaphore>) {
+        guarded = makeGuarded<Primitive>(workload.lockCount(), semaphorePermits(params));
+    } else {
+        guarded = makeGuarded<Primitive>(workload.lockCount());
+    }
+    vector<ThreadStats> stats(params.tasks); // По записи на задачу
+    InlineExecutor inlineExecutor;
+    SharedQueueExecutor sharedExecutor;
+    Executor& executor = params.numThreads == 1 ? static_cast<Executor&>(inlineExecutor) : sharedExecutor;
+    AsyncEvent start;
+    atomic<int> remaining{params.tasks};
+    atomic<int> spawners{0};
 
-    {
-        lock_guard<std::mutex> lock(mutex); // Блокируем мьютекс
-        ready = true; // Устанавливаем флаг в истину
-        cv.notify_all(); // Уведомляем все потоки
+    auto elapsed = pool.run(params.numThreads, [&](int i) {
+        for (int task = i; task < params.tasks; task += params.numThreads) {
+            executor.post(coroTask(task, params, workload, guarded, stats[task], executor,
+                                   WaitStart ? &start : nullptr, remaining).handle);
+        }
+        // Событие открывает поток, последним закончивший создавать задачи
+        if (WaitStart && spawners.fetch_add(1) + 1 == params.numThreads) {
+            start.set();
+        }
+        executor.run();
+    });
+    if constexpr (is_same_v<Primitive, AsyncMutex>) {
+        checkExclusion(guarded, stats);
     }
+    return {elapsed,
+            {{"max_wait_ns", maxWait(stats)}, {"ns_per_waiter", elapsed.count() * 1e9 / params.tasks}}};
+}
 
+// Функция для тестирования варианта "поток на ожидающего": params.waiterThreads потоков ОС
+// вне пула делают то же, что задачи CoroEvent. Число потоков задается отдельно от --tasks:
+// сотни тысяч потоков упираются в лимиты системы. Если система не дает создать столько
+// потоков, тест доводится до конца с созданными, а прогон считается ошибочным.
+RunResult testThreadPerWaiter(WorkerPool&, const TestParams& params) {
+    Workload workload(params.workload);
+    auto monitors = makeGuarded<MonitorState<StdMonitor>>(workload.lockCount());
+    vector<ThreadStats> stats(params.waiterThreads);
+    vector<thread> threads;
+    threads.reserve(params.waiterThreads);
+
+    auto start = chrono::steady_clock::now();
+    try {
+        for (int i = 0; i < params.waiterThreads; ++i) {
+            threads.emplace_back([&, i]() {
+                runLockLoop(i, params, workload, monitors, stats[i], enterMonitor<StdMonitor>, exitMonitor<StdMonitor>);
+            });
+        }
+    } catch (const system_error& e) {
+        cerr << "Создано потоков: " << threads.size() << " из " << params.waiterThreads << " (" << e.what() << ")" << endl;
+        benchErrors.fetch_add(1, memory_order_relaxed);
+    }
+    for (auto& g : monitors) {
+        g->primitive.monitor.lock();
+        g->primitive.ready = true; // Открываем мониторы для всех потоков
+        g->primitive.monitor.notifyAll();
+        g->primitive.monitor.unlock();
+    }
     for (auto& t : threads) {
-        t.join(); // Дожидаемся завершения всех потоков
+        t.join();
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    checkExclusion(monitors, stats);
+    return {elapsed,
+            {{"max_wait_ns", maxWait(stats)},
+             {"threads_created", static_cast<double>(threads.size())},
+             {"ns_per_waiter", elapsed.count() * 1e9 / max<size_t>(1, threads.size())}}};
+}
+
+// ---------------------------------------------------------------------------
+// Харнесс бенчмарка: прогрев, повторы, статистика, перебор параметров, CSV/JSON
+// ---------------------------------------------------------------------------
+
+// Описание одного теста: имя и функция запуска на пуле с заданными параметрами.
+// Тест со своими потоками не пользуется пулом и не зависит от --threads: он
+// запускается один раз, а в результатах threads равно числу его потоков.
+struct BenchTest {
+    string name;
+    function<RunResult(WorkerPool&, const TestParams&)> run;
+    bool ownThreads = false;
+};
+
+// Параметры запуска бенчмарка
+struct BenchConfig {
+    int warmupRuns = 1;            // Число прогревочных запусков (не учитываются в статистике)
+    int repetitions = 5;           // Число измеряемых запусков для каждой точки
+    vector<int> threadCounts;      // Перебираемые количества потоков (пусто - 1..2x hardware_concurrency)
+    vector<int> iterationCounts = {1}; // Перебираемые количества итераций на поток
+    vector<string> tests;          // Фильтр по именам тестов (пусто - все тесты)
+    string csvPath;                // Файл для вывода в формате CSV
+    string jsonPath;               // Файл для вывода в формате JSON
+    PinLayout pinLayout = PinLayout::None; // Раскладка привязки потоков к процессорам
+    int numaNode = 0;              // NUMA-узел для раскладки numa:N
+    int permits = 0;               // Разрешений у семафоров (0 - половина потоков)
+    int phases = 100;              // Количество фаз в тестах барьеров
+    int tasks = 100000;            // Количество задач в тестах сопрограмм
+    int waiterThreads = 10000;     // Количество потоков в тесте потоков на ожидающего
+    WorkloadConfig workload;       // Модель нагрузки
+    vector<double> readFractions = {0}; // Перебираемые доли чтений
+    PerfConfig perf;               // Сбор счетчиков perf_event_open
+    LogMode logMode = LogMode::Async; // Вывод сообщений потоков
+};
+
+// Значения одной метрики по всем запускам точки перебора
+struct MetricSeries {
+    string name;
+    vector<double> samples;
+    BenchStats stats;
+};
+
+// Результат одной точки перебора
+struct BenchRecord {
+    string test;
+    int threads;
+    int iterations;
+    double readFraction;
+    BenchStats stats;
+    vector<double> samples;
+    vector<MetricSeries> metrics; // Дополнительные метрики теста по всем запускам
+};
+
+// Количества потоков по умолчанию: степени двойки от 1 до 2x hardware_concurrency
+vector<int> defaultThreadCounts() {
+    int hw = max(1u, thread::hardware_concurrency());
+    vector<int> counts;
+    for (int n = 1; n < 2 * hw; n *= 2) {
+        counts.push_back(n);
+    }
+    counts.push_back(2 * hw);
+    return counts;
+}
+
+// Разбор целого числа не меньше minValue
+bool parseInt(const string& text, int minValue, int& out) {
+    try {
+        size_t pos = 0;
+        int value = stoi(text, &pos);
+        if (pos != text.size() || value < minValue) {
+            return false;
+        }
+        out = value;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Разбор вещественного числа из отрезка [minValue, maxValue]
+bool parseDouble(const string& text, double minValue, double maxValue, double& out) {
+    try {
+        size_t pos = 0;
+        double value = stod(text, &pos);
+        if (pos != text.size() || !(value >= minValue && value <= maxValue)) {
+            return false;
+        }
+        out = value;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Разбор списка положительных чисел вида "1,2,4"
+bool parseIntList(const string& text, vector<int>& out) {
+    out.clear();
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        int value;
+        if (!parseInt(item, 1, value)) {
+            return false;
+        }
+        out.push_back(value);
+    }
+    return !out.empty();
+}
+
+// Разбор списка долей из отрезка [0, 1] вида "0.5,0.9,0.99"
+bool parseFractionList(const string& text, vector<double>& out) {
+    out.clear();
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        double value;
+        if (!parseDouble(item, 0, 1, value)) {
+            return false;
+        }
+        out.push_back(value);
+    }
+    return !out.empty();
+}
+
+// Разбор списка строк вида "Mutex,SpinLock"
+vector<string> parseStringList(const string& text) {
+    vector<string> out;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) {
+            out.push_back(item);
+        }
+    }
+    return out;
+}
+
+// Разбор раскладки привязки потоков
+bool parsePinLayout(const string& text, BenchConfig& config) {
+    if (text == "none") {
+        config.pinLayout = PinLayout::None;
+    } else if (text == "compact") {
+        config.pinLayout = PinLayout::Compact;
+    } else if (text == "scatter") {
+        config.pinLayout = PinLayout::Scatter;
+    } else if (text == "smt") {
+        config.pinLayout = PinLayout::Smt;
+    } else if (text.rfind("numa:", 0) == 0 && parseInt(text.substr(5), 0, config.numaNode)) {
+        config.pinLayout = PinLayout::Numa;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+string pinLayoutName(const BenchConfig& config) {
+    switch (config.pinLayout) {
+    case PinLayout::None:
+        return "none";
+    case PinLayout::Compact:
+        return "compact";
+    case PinLayout::Scatter:
+        return "scatter";
+    case PinLayout::Smt:
+        return "smt";
+    case PinLayout::Numa:
+        return "numa:" + to_string(config.numaNode);
+    }
+    return "unknown";
+}
+
+void printUsage(const char* program) {
+    cout << "Использование: " << program << " [параметры]" << endl
+         << "  --warmup N        число прогревочных запусков (по умолчанию 1)" << endl
+         << "  --reps N          число измеряемых запусков (по умолчанию 5)" << endl
+         << "  --threads LIST    количества потоков, например 1,2,4 (по умолчанию 1..2x ядер)" << endl
+         << "  --iters LIST      количества итераций на поток, например 1,100 (по умолчанию 1)" << endl
+         << "  --tests LIST      запускаемые тесты, например Mutex,SpinLock (по умолчанию все)" << endl
+         << "  --csv FILE        записать результаты в CSV" << endl
+         << "  --json FILE       записать результаты в JSON" << endl
+         << "  --permits N       разрешений у семафоров (по умолчанию половина потоков)" << endl
+         << "  --phases N        количество фаз в тестах барьеров (по умолчанию 100)" << endl
+         << "  --tasks N         задач в тестах Coro* (по умолчанию 100000)" << endl
+         << "  --waiter-threads N потоков ОС в тесте ThreadPerWaiter (по умолчанию 10000); тест не зависит" << endl
+         << "                    от --threads и идет одной точкой threads=N, сравнение с Coro* - по ns_per_waiter" << endl
+         << "  --cs-ns NS        работа внутри критической секции, нс (по умолчанию 0)" << endl
+         << "  --think-ns NS     работа вне критической секции между захватами, нс (по умолчанию 0)" << endl
+         << "  --locks N         число независимых экземпляров примитива (по умолчанию 1)" << endl
+         << "  --zipf S          выбор экземпляра по Ципфу с показателем S (по умолчанию 0 - равномерно)" << endl
+         << "  --read-fraction LIST доли операций-чтений защищенных данных, например 0.5,0.9,0.99,0.999" << endl
+         << "                    (по умолчанию 0; в RW-тестах чтения берут блокировку на чтение)" << endl
+         << "  --perf            собирать счетчики perf: циклы, инструкции, промахи LLC," << endl
+         << "                    переключения контекста, вызовы futex" << endl
+         << "  --perf-hitm CODE  код raw-события HITM для процессора (например 0x04d2), включает --perf" << endl
+         << "  --log MODE        вывод сообщений потоков: async (фоновый поток), sync (cout), off (по умолчанию async)" << endl
+         << "  --pin LAYOUT      привязка потоков: none, compact, scatter, smt, numa:N (по умолчанию none)" << endl;
+}
+
+// Разбор аргументов командной строки; возвращает false при ошибке
+bool parseArgs(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        }
+        if (arg == "--perf") {
+            config.perf.enabled = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Не задано значение для " << arg << endl;
+            return false;
+        }
+        string value = argv[++i];
+        vector<int> numbers;
+        if (arg == "--warmup" || arg == "--reps" || arg == "--permits" || arg == "--phases" || arg == "--tasks" ||
+            arg == "--waiter-threads") {
+            int& target = (arg == "--warmup") ? config.warmupRuns
+                        : (arg == "--reps")   ? config.repetitions
+                        : (arg == "--phases") ? config.phases
+                        : (arg == "--tasks")  ? config.tasks
+                        : (arg == "--waiter-threads") ? config.waiterThreads
+                                              : config.permits;
+            bool positive = arg == "--reps" || arg == "--phases" || arg == "--tasks" || arg == "--waiter-threads";
+            if (!parseInt(value, positive ? 1 : 0, target)) {
+                cerr << "Некорректное значение для " << arg << ": " << value << endl;
+                return false;
+            }
+        } else if (arg == "--locks") {
+            if (!parseInt(value, 1, config.workload.locks)) {
+                cerr << "Некорректное значение для " << arg << ": " << value << endl;
+                return false;
+            }
+        } else if (arg == "--read-fraction") {
+            if (!parseFractionList(value, config.readFractions)) {
+                cerr << "Некорректный список для " << arg << ": " << value << endl;
+                return false;
+            }
+        } else if (arg == "--cs-ns" || arg == "--think-ns" || arg == "--zipf") {
+            double& target = (arg == "--cs-ns")    ? config.workload.csNs
+                           : (arg == "--think-ns") ? config.workload.thinkNs
+                                                   : config.workload.zipf;
+            if (!parseDouble(value, 0, 1e12, target)) {
+                cerr << "Некорректное значение для " << arg << ": " << value << endl;
+                return false;
+            }
+        } else if (arg == "--threads" || arg == "--iters") {
+            if (!parseIntList(value, numbers)) {
+                cerr << "Некорректный список для " << arg << ": " << value << endl;
+                return false;
+            }
+            (arg == "--threads" ? config.threadCounts : config.iterationCounts) = numbers;
+        } else if (arg == "--tests") {
+            config.tests = parseStringList(value);
+        } else if (arg == "--csv") {
+            config.csvPath = value;
+        } else if (arg == "--json") {
+            config.jsonPath = value;
+        } else if (arg == "--perf-hitm") {
+            try {
+                size_t pos = 0;
+                config.perf.hitmEvent = stoull(value, &pos, 0);
+                if (pos != value.size() || config.perf.hitmEvent == 0) {
+                    throw invalid_argument(value);
+                }
+            } catch (...) {
+                cerr << "Некорректный код события: " << value << endl;
+                return false;
+            }
+            config.perf.enabled = true;
+        } else if (arg == "--log") {
+            if (!parseLogMode(value, config.logMode)) {
+                cerr << "Неизвестный режим журнала: " << value << endl;
+                return false;
+            }
+        } else if (arg == "--pin") {
+            if (!parsePinLayout(value, config)) {
+                cerr << "Неизвестная раскладка привязки: " << value << endl;
+                return false;
+            }
+        } else {
+            cerr << "Неизвестный параметр: " << arg << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Описание окружения, чтобы сравнивать запуски между версиями ядра и компилятора
+string kernelRelease() {
+    utsname info;
+    if (uname(&info) != 0) {
+        return "unknown";
+    }
+    return string(info.sysname) + " " + info.release;
+}
+
+string compilerVersion() {
+#if defined(__clang__)
+    return string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return string("gcc ") + __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+string logModeName(LogMode mode) {
+    switch (mode) {
+    case LogMode::Async:
+        return "async";
+    case LogMode::Sync:
+        return "sync";
+    case LogMode::Off:
+        return "off";
+    }
+    return "unknown";
+}
+
+// Экранирование строки для JSON
+string jsonEscape(const string& text) {
+    string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+// Имена всех метрик в порядке первого появления
+vector<string> metricNames(const vector<BenchRecord>& records) {
+    vector<string> names;
+    for (const auto& r : records) {
+        for (const auto& m : r.metrics) {
+            if (find(names.begin(), names.end(), m.name) == names.end()) {
+                names.push_back(m.name);
+            }
+        }
+    }
+    return names;
+}
+
+// Метрика записи по имени; nullptr, если тест ее не измеряет
+const MetricSeries* findMetric(const BenchRecord& record, const string& name) {
+    for (const auto& m : record.metrics) {
+        if (m.name == name) {
+            return &m;
+        }
+    }
+    return nullptr;
+}
+
+bool writeCsv(const string& path, const vector<BenchRecord>& records) {
+    ofstream out(path);
+    if (!out) {
+        cerr << "Не удалось открыть файл " << path << endl;
+        return false;
     }
+    // Для каждой метрики - столбцы median и p99; у тестов без метрики они пустые
+    vector<string> names = metricNames(records);
+    out << "test,threads,iterations,read_fraction,repetitions,min_s,median_s,p99_s,mean_s,stddev_s";
+    for (const auto& name : names) {
+        out << ',' << name << "_median," << name << "_p99";
+    }
+    out << '\n';
+    out << setprecision(9);
+    for (const auto& r : records) {
+        out << r.test << ',' << r.threads << ',' << r.iterations << ',' << r.readFraction << ',' << r.samples.size() << ','
+            << r.stats.min << ',' << r.stats.median << ',' << r.stats.p99 << ','
+            << r.stats.mean << ',' << r.stats.stddev;
+        for (const auto& name : names) {
+            if (const MetricSeries* m = findMetric(r, name)) {
+                out << ',' << m->stats.median << ',' << m->stats.p99;
+            } else {
+                out << ",,";
+            }
+        }
+        out << '\n';
+    }
+    return true;
+}
+
+bool writeJson(const string& path, const BenchConfig& config, const vector<BenchRecord>& records) {
+    ofstream out(path);
+    if (!out) {
+        cerr << "Не удалось открыть файл " << path << endl;
+        return false;
+    }
+    out << setprecision(9);
+    out << "{\n";
+    out << "  \"environment\": {\"kernel\": \"" << jsonEscape(kernelRelease()) << "\", \"compiler\": \""
+        << jsonEscape(compilerVersion()) << "\", \"hardware_concurrency\": " << thread::hardware_concurrency()
+        << ", \"pin\": \"" << pinLayoutName(config) << "\", \"log\": \"" << logModeName(config.logMode) << "\", \"perf\": " << (config.perf.enabled ? "true" : "false") << ", \"permits\": " << config.permits << ", \"phases\": " << config.phases << ", \"tasks\": " << config.tasks
+        << ", \"waiter_threads\": " << config.waiterThreads
+        << ", \"cs_ns\": " << config.workload.csNs << ", \"think_ns\": " << config.workload.thinkNs
+        << ", \"locks\": " << config.workload.locks << ", \"zipf\": " << config.workload.zipf
+        << ", \"spin_loops_per_ns\": " << spinLoopsPerNs() << ", \"warmup\": " << config.warmupRuns << ", \"repetitions\": " << config.repetitions << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const auto& r = records[i];
+        out << "    {\"test\": \"" << jsonEscape(r.test) << "\", \"threads\": " << r.threads
+            << ", \"iterations\": " << r.iterations << ", \"read_fraction\": " << r.readFraction
+            << ", \"min_s\": " << r.stats.min
+            << ", \"median_s\": " << r.stats.median << ", \"p99_s\": " << r.stats.p99
+            << ", \"mean_s\": " << r.stats.mean << ", \"stddev_s\": " << r.stats.stddev << ", \"samples_s\": [";
+        for (size_t j = 0; j < r.samples.size(); ++j) {
+            out << (j ? ", " : "") << r.samples[j];
+        }
+        out << "], \"metrics\": {";
+        for (size_t m = 0; m < r.metrics.size(); ++m) {
+            const auto& metric = r.metrics[m];
+            out << (m ? ", " : "") << '"' << jsonEscape(metric.name) << "\": {\"median\": " << metric.stats.median
+                << ", \"p99\": " << metric.stats.p99 << ", \"samples\": [";
+            for (size_t j = 0; j < metric.samples.size(); ++j) {
+                out << (j ? ", " : "") << metric.samples[j];
+            }
+            out << "]}";
+        }
+        out << "}}" << (i + 1 < records.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+// Счетчики perf запуска как метрики; недоступные события пропускаются
+void appendPerfMetrics(const PerfSample& totals, vector<Metric>& metrics) {
+    for (int e = 0; e < PerfEventCount; ++e) {
+        if (!isnan(totals[e])) {
+            metrics.push_back({perfEventNames[e], totals[e]});
+        }
+    }
+    if (!isnan(totals[PerfCycles]) && !isnan(totals[PerfInstructions]) && totals[PerfCycles] > 0) {
+        metrics.push_back({"ipc", totals[PerfInstructions] / totals[PerfCycles]});
+    }
+}
 
-    auto endTime = std::chrono::high_resolution_clock::now(); // Засекаем время окончания
-    return endTime - startTime; // Возвращаем время выполнения
+// Прогон одной точки перебора: прогрев, затем repetitions измерений
+BenchRecord runBenchPoint(WorkerPool& pool, const BenchTest& test, int numThreads, int iterations, double readFraction,
+                          const BenchConfig& config) {
+    TestParams params;
+    params.numThreads = numThreads;
+    params.iterations = iterations;
+    params.permits = config.permits;
+    params.phases = config.phases;
+    params.tasks = config.tasks;
+    params.waiterThreads = config.waiterThreads;
+    params.workload = config.workload;
+    params.workload.readFraction = readFraction;
+    for (int w = 0; w < config.warmupRuns; ++w) {
+        test.run(pool, params);
+    }
+    BenchRecord record{test.name, numThreads, iterations, readFraction, {}, {}, {}};
+    for (int r = 0; r < config.repetitions; ++r) {
+        RunResult result = test.run(pool, params);
+        if (config.perf.enabled) {
+            appendPerfMetrics(pool.lastPerfTotals(), result.metrics);
+        }
+        record.samples.push_back(result.elapsed.count());
+        for (const auto& metric : result.metrics) {
+            auto it = find_if(record.metrics.begin(), record.metrics.end(),
+                              [&metric](const MetricSeries& m) { return m.name == metric.name; });
+            if (it == record.metrics.end()) {
+                record.metrics.push_back({metric.name, {}, {}});
+                it = record.metrics.end() - 1;
+            }
+            it->samples.push_back(metric.value);
+        }
+    }
+    AsyncLog::instance().flush(); // Сообщения точки выводятся до ее итоговой строки
+    record.stats = computeStats(record.samples);
+    for (auto& metric : record.metrics) {
+        metric.stats = computeStats(metric.samples);
+    }
+    return record;
 }
 
-int main() {
-    int numThreads = 12; // Количество потоков
-    cout << "Количество потоков: " << numThreads << endl;
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (config.threadCounts.empty()) {
+        config.threadCounts = defaultThreadCounts();
+    }
 
-    cout << "Testing Mutex..." << endl;
-    auto timeMutex = testMutex(numThreads);
-    cout << "Mutex time: " << timeMutex.count() << " seconds" << endl << endl;
+    vector<BenchTest> allTests = {
+        {"Mutex", testLock<mutex>},
+        {"Semaphore", testSemaphore<CvSemaphore>},
+        {"FutexSemaphore", testSemaphore<FutexSemaphore>},
+        {"SemaphoreSlim", testSemaphore<SlimSemaphore>},
+        {"CountingSemaphore", testSemaphore<StdCountingSemaphore>},
+        {"BinarySemaphore", testSemaphore<StdBinarySemaphore>},
+        {"SpinWait", testSpinWait},
+        {"Barrier", testBarrier<CvBarrier>},
+        {"SenseBarrier", testBarrier<SenseBarrier>},
+        {"TreeBarrier", testBarrier<TreeBarrier>},
+        {"DisseminationBarrier", testBarrier<DisseminationBarrier>},
+        {"StdBarrier", testBarrier<StdBarrier>},
+        {"SpinLock", testLock<NaiveSpinLock>},
+        {"TtasSpinLock", testLock<TtasSpinLock>},
+        {"TicketLock", testLock<TicketLock>},
+        {"McsLock", testLock<McsLock>},
+        {"ClhLock", testLock<ClhLock>},
+        {"SharedMutex", testRwLock<shared_mutex>},
+        {"FutexRwLock", testRwLock<FutexRwLock>},
+        {"BigReaderLock", testRwLock<BigReaderLock>},
+        {"SeqLock", testRwLock<SeqLock>},
+        {"Monitor", testMonitor<StdMonitor>},
+        {"ParkingMonitor", testMonitor<ParkingMonitor>},
+        {"ByteLock", testLock<ByteLock>},
+        {"CoroMutex", testCoro<AsyncMutex, false>},
+        {"CoroSemaphore", testCoro<AsyncSemaphore, false>},
+        {"CoroEvent", testCoro<AsyncMutex, true>},
+        {"ThreadPerWaiter", testThreadPerWaiter, true},
+        {"ParkingSemaphore", testSemaphore<ParkingSemaphore>},
+        {"RandomMt19937", testRandom<RandomSource::Mt19937>},
+        {"RandomXoshiro", testRandom<RandomSource::Xoshiro>},
+        {"RandomFillScalar", testRandom<RandomSource::FillScalar>},
+        {"RandomFill", testRandom<RandomSource::Fill>},
+    };
 
-    cout << "Testing Semaphore..." << endl;
-    auto timeSemaphore = testSemaphore(numThreads);
-    cout << "Semaphore time: " << timeSemaphore.count() << " seconds" << endl << endl;
+    vector<BenchTest> tests;
+    for (const auto& test : allTests) {
+        if (config.tests.empty() || find(config.tests.begin(), config.tests.end(), test.name) != config.tests.end()) {
+            tests.push_back(test);
+        }
+    }
+    if (tests.empty()) {
+        cerr << "Ни один тест не соответствует фильтру --tests" << endl;
+        return 1;
+    }
 
-    cout << "Testing SemaphoreSlim..." << endl;
-    auto timeSemaphoreSlim = testSemaphoreSlim(numThreads);
-    cout << "SemaphoreSlim time: " << timeSemaphoreSlim.count() << " seconds" << endl << endl;
+    AsyncLog::instance().setMode(config.logMode);
 
-    cout << "Testing SpinWait..." << endl;
-    auto timeSpinWait = testSpinWait(numThreads);
-    cout << "SpinWait time: " << timeSpinWait.count() << " seconds" << endl << endl;
+    vector<int> cpuOrder = buildCpuOrder(config.pinLayout, readCpuTopology(), config.numaNode);
+    if (config.pinLayout != PinLayout::None && cpuOrder.empty()) {
+        cerr << "Нет доступных процессоров для раскладки " << pinLayoutName(config) << endl;
+        return 1;
+    }
+    if (!cpuOrder.empty()) {
+        cout << "Привязка потоков (" << pinLayoutName(config) << "):";
+        for (int cpu : cpuOrder) {
+            cout << ' ' << cpu;
+        }
+        cout << endl;
+    }
+    // Пул создается один раз: создание потоков не попадает в измерения
+    WorkerPool pool(*max_element(config.threadCounts.begin(), config.threadCounts.end()), cpuOrder, config.perf);
+    if (config.perf.enabled) {
+        pool.run(1, [](int) {});
+        vector<Metric> probe;
+        appendPerfMetrics(pool.lastPerfTotals(), probe);
+        if (probe.empty()) {
+            cerr << "Счетчики perf недоступны (проверьте /proc/sys/kernel/perf_event_paranoid)" << endl;
+        }
+    }
 
-    cout << "Testing Barrier..." << endl;
-    auto timeBarrier = testBarrier(numThreads);
-    cout << "Barrier time: " << timeBarrier.count() << " seconds" << endl << endl;
+    // Coro* и ThreadPerWaiter сравниваются по ns_per_waiter: число ожидающих у них задается отдельно
+    bool coroTests = any_of(tests.begin(), tests.end(), [](const BenchTest& t) { return t.name.rfind("Coro", 0) == 0; });
+    bool waiterTest = any_of(tests.begin(), tests.end(), [](const BenchTest& t) { return t.ownThreads; });
+    if (coroTests && waiterTest && config.tasks != config.waiterThreads) {
+        cerr << "Внимание: задач в Coro* (" << config.tasks << ") и потоков в ThreadPerWaiter (" << config.waiterThreads
+             << ") разное число, сравнивайте ns_per_waiter, а не время прогона" << endl;
+    }
 
-    cout << "Testing SpinLock..." << endl;
-    auto timeSpinLock = testSpinLock(numThreads);
-    cout << "SpinLock time: " << timeSpinLock.count() << " seconds" << endl << endl;
+    vector<BenchRecord> records;
+    for (const auto& test : tests) {
+        cout << "Testing " << test.name << "..." << endl;
+        vector<int> threadCounts = test.ownThreads ? vector<int>{config.waiterThreads} : config.threadCounts;
+        for (int numThreads : threadCounts) {
+            for (int iterations : config.iterationCounts) {
+                for (double readFraction : config.readFractions) {
+                    records.push_back(runBenchPoint(pool, test, numThreads, iterations, readFraction, config));
+                    const auto& s = records.back().stats;
+                    cout << test.name << " threads=" << numThreads << " iters=" << iterations;
+                    if (config.readFractions.size() > 1 || readFraction > 0) {
+                        cout << " reads=" << readFraction;
+                    }
+                    cout << ": min=" << s.min << " median=" << s.median << " p99=" << s.p99
+                         << " stddev=" << s.stddev << " seconds";
+                    for (const auto& metric : records.back().metrics) {
+                        cout << ", " << metric.name << ": median=" << metric.stats.median << " p99=" << metric.stats.p99;
+                    }
+                    cout << endl << endl;
+                }
+            }
+        }
+    }
 
-    cout << "Testing Monitor..." << endl;
-    auto timeMonitor = testMonitor(numThreads);
-    cout << "Monitor time: " << timeMonitor.count() << " seconds" << endl << endl;
+    if (!config.csvPath.empty() && !writeCsv(config.csvPath, records)) {
+        return 1;
+    }
+    if (!config.jsonPath.empty() && !writeJson(config.jsonPath, config, records)) {
+        return 1;
+    }
+    if (benchErrors.load() > 0) {
+        cerr << "Прогонов с ошибками: " << benchErrors.load() << endl;
+        return 1;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,22 +1,42 @@
 #include <iostream>
 #include <vector>
-#include <map>
+#include <unordered_map>
+#include <deque>
+#include <string_view>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
 #include <thread>
 #include <chrono>
 #include <random>
 #include <algorithm>
 #include <atomic>
+#include <barrier>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <bit>
+#include <cstring>
+#include <cerrno>
+#include <charconv>
+#include <fstream>
+#include <exception>
+#include <mutex>
+#include <functional>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+#include "async_log.h"
+#include "fast_random.h"
+#include "kernel_set.h"
 
 using namespace std;
 
-// Структура для хранения информации о сотруднике
-struct Employee {
-    string fio;        // ФИО сотрудника
-    string position;   // Должность
-    string department; // Отдел
-    double salary;     // Зарплата
-};
-
 // Векторы с данными для генерации случайных сотрудников
 vector<string> surnames = {"Иванов", "Петров", "Сидоров", "Козлов", "Смирнов", "Кузнецов", "Попов", "Васильев", "Михайлов", "Новиков"};
 vector<string> names = {"Иван", "Петр", "Сидор", "Козло", "Смирн", "Алексей", "Дмитрий", "Александр", "Михаил", "Николай"};
@@ -24,78 +44,2180 @@ vector<string> patronymics = {"Иванович", "Петрович", "Сидо
 vector<string> positions = {"Инженер", "Менеджер", "Программист", "Аналитик", "Тестировщик"};
 vector<string> departments = {"Отдел разработки", "Отдел продаж", "Отдел маркетинга", "Отдел финансов", "Отдел HR"};
 
-// Функция для генерации случайных сотрудников
-vector<Employee> generateEmployees(int count) {
-    vector<Employee> employees;
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<> surnameDist(0, surnames.size() - 1);
-    uniform_int_distribution<> nameDist(0, names.size() - 1);
-    uniform_int_distribution<> patronymicDist(0, patronymics.size() - 1);
-    uniform_int_distribution<> positionDist(0, positions.size() - 1);
-    uniform_int_distribution<> departmentDist(0, departments.size() - 1);
-    uniform_real_distribution<> salaryDist(30000, 100000);
+// Аллокатор с выравниванием Align байт: столбцы начинаются с границы строки кэша
+template <typename T, size_t Align>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Align>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), align_val_t(Align)));
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, align_val_t(Align));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Align>&) const {
+        return true;
+    }
+};
+
+template <typename T>
+using AlignedVector = vector<T, AlignedAllocator<T, 64>>;
+
+// Словарь строк: каждая строка хранится один раз, в таблице - только ее код.
+// Строки лежат в deque, адреса не меняются, поэтому ключи индекса - string_view,
+// и поиск по фрагменту входного файла не создает std::string.
+template <typename Code>
+class StringDictionary {
+public:
+    // Код строки; новая строка получает следующий свободный код
+    Code intern(string_view value) {
+        auto it = codes.find(value);
+        if (it != codes.end()) {
+            return it->second;
+        }
+        if (values.size() > numeric_limits<Code>::max()) {
+            throw length_error("Словарь переполнен: " + string(value));
+        }
+        Code code = static_cast<Code>(values.size());
+        values.emplace_back(value);
+        codes.emplace(values.back(), code);
+        return code;
+    }
+
+    // Поиск без добавления; безопасен при одновременных вызовах, пока словарь не меняется
+    bool find(string_view value, Code& code) const {
+        auto it = codes.find(value);
+        if (it == codes.end()) {
+            return false;
+        }
+        code = it->second;
+        return true;
+    }
+
+    const string& at(Code code) const {
+        return values[code];
+    }
+
+    size_t size() const {
+        return values.size();
+    }
+
+private:
+    deque<string> values;
+    unordered_map<string_view, Code> codes;
+};
+
+using DeptCode = uint8_t;
+
+// Словари строковых полей сотрудника; общие для таблицы в памяти и двоичного файла
+struct EmployeeDictionaries {
+    StringDictionary<uint16_t> surnameDict;
+    StringDictionary<uint16_t> nameDict;
+    StringDictionary<uint16_t> patronymicDict;
+    StringDictionary<uint8_t> positionDict;
+    StringDictionary<DeptCode> departmentDict;
+
+    // Коды из файла идут в StringDictionary::at без проверки, поэтому каждую строку
+    // файла нужно проверить до того, как она попадет в журнал
+    bool codesInRange(uint16_t surname, uint16_t name, uint16_t patronymic, uint8_t position,
+                      DeptCode department) const {
+        return surname < surnameDict.size() && name < nameDict.size() && patronymic < patronymicDict.size() &&
+               position < positionDict.size() && department < departmentDict.size();
+    }
+};
+
+// Таблица сотрудников по столбцам. Отдел и должность - коды словарей, ФИО - три
+// кода (фамилия, имя, отчество), зарплата - в отдельном выровненном массиве.
+// Строка занимает 16 байт вместо трех std::string и double.
+struct EmployeeTable : EmployeeDictionaries {
+    AlignedVector<double> salary;    // Зарплата
+    vector<DeptCode> department;     // Отдел
+    vector<uint8_t> position;        // Должность
+    vector<uint16_t> surname;        // Фамилия
+    vector<uint16_t> name;           // Имя
+    vector<uint16_t> patronymic;     // Отчество
 
-    for (int i = 0; i < count; ++i) {
-        Employee emp;
-        emp.fio = surnames[surnameDist(gen)] + " " + names[nameDist(gen)] + " " + patronymics[patronymicDist(gen)];
-        emp.position = positions[positionDist(gen)];
-        emp.department = departments[departmentDist(gen)];
-        emp.salary = salaryDist(gen);
-        employees.push_back(emp);
+    size_t size() const {
+        return salary.size();
     }
 
-    return employees;
+    void reserve(size_t n) {
+        salary.reserve(n);
+        department.reserve(n);
+        position.reserve(n);
+        surname.reserve(n);
+        name.reserve(n);
+        patronymic.reserve(n);
+    }
+
+    void resize(size_t n) {
+        salary.resize(n);
+        department.resize(n);
+        position.resize(n);
+        surname.resize(n);
+        name.resize(n);
+        patronymic.resize(n);
+    }
+
+    void append(const string& surnameValue, const string& nameValue, const string& patronymicValue,
+                const string& positionValue, const string& departmentValue, double salaryValue) {
+        surname.push_back(surnameDict.intern(surnameValue));
+        name.push_back(nameDict.intern(nameValue));
+        patronymic.push_back(patronymicDict.intern(patronymicValue));
+        position.push_back(positionDict.intern(positionValue));
+        department.push_back(departmentDict.intern(departmentValue));
+        salary.push_back(salaryValue);
+    }
+};
+
+// Динамическое распределение заданий 0..count-1 между numThreads потоками; вызывающий
+// поток работает как поток 0. Первое исключение останавливает раздачу и пробрасывается.
+template <typename Body>
+void parallelForDynamic(int numThreads, size_t count, Body&& body) {
+    atomic<size_t> next{0};
+    exception_ptr error;
+    mutex errorMutex;
+    auto worker = [&](int t) {
+        try {
+            for (size_t item; (item = next.fetch_add(1, memory_order_relaxed)) < count;) {
+                body(t, item);
+            }
+        } catch (...) {
+            lock_guard<mutex> lock(errorMutex);
+            if (!error) {
+                error = current_exception();
+            }
+            next.store(count, memory_order_relaxed);
+        }
+    };
+    vector<thread> threads;
+    for (int t = 1; t < numThreads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
 }
 
-// Функция для расчета средней зарплаты по отделам (однопоточная версия)
-map<string, double> calculateAverageSalary(const vector<Employee>& employees) {
-    map<string, double> totalSalary; // Сумма зарплат по отделам
-    map<string, int> count;          // Количество сотрудников по отделам
+// Строк в блоке генератора; у каждого блока свое зерно
+constexpr size_t generatorBlockRows = 1 << 16;
 
-    // Проходим по всем сотрудникам и суммируем их зарплаты
-    for (const auto& emp : employees) {
-        totalSalary[emp.department] += emp.salary;
-        count[emp.department]++;
+// Зерно блока: SplitMix64 от зерна набора и номера блока, поэтому набор зависит
+// только от seed и count, но не от числа потоков и порядка, в котором они берут блоки
+uint64_t generatorBlockSeed(uint64_t seed, size_t block) {
+    uint64_t state = seed ^ (block * 0xd1b54a32d192ed03ULL);
+    return splitMix64(state);
+}
+
+// Функция для генерации случайных сотрудников.
+// Словари заполняются заранее, столбцы выделяются один раз, и потоки пишут коды
+// прямо в свои блоки строк: на строку нет ни строковых операций, ни выделений памяти.
+// Генератор - xoshiro256** из fast_random.h, общий с 1number.cpp.
+EmployeeTable generateEmployees(size_t count, uint64_t seed, int numThreads = 1) {
+    EmployeeTable table;
+    auto internAll = [](auto& dict, const vector<string>& values) {
+        vector<decltype(dict.intern(""))> codes;
+        for (const auto& value : values) {
+            codes.push_back(dict.intern(value));
+        }
+        return codes;
+    };
+    auto surnameCodes = internAll(table.surnameDict, surnames);
+    auto nameCodes = internAll(table.nameDict, names);
+    auto patronymicCodes = internAll(table.patronymicDict, patronymics);
+    auto positionCodes = internAll(table.positionDict, positions);
+    auto departmentCodes = internAll(table.departmentDict, departments);
+    table.resize(count);
+
+    size_t numBlocks = (count + generatorBlockRows - 1) / generatorBlockRows;
+    parallelForDynamic(numThreads, numBlocks, [&](int, size_t block) {
+        Xoshiro256 gen(generatorBlockSeed(seed, block));
+        size_t end = min(count, (block + 1) * generatorBlockRows);
+        for (size_t i = block * generatorBlockRows; i < end; ++i) {
+            table.surname[i] = surnameCodes[gen.nextBelow(surnameCodes.size())];
+            table.name[i] = nameCodes[gen.nextBelow(nameCodes.size())];
+            table.patronymic[i] = patronymicCodes[gen.nextBelow(patronymicCodes.size())];
+            table.position[i] = positionCodes[gen.nextBelow(positionCodes.size())];
+            table.department[i] = departmentCodes[gen.nextBelow(departmentCodes.size())];
+            table.salary[i] = 30000 + 70000 * gen.nextDouble(); // Равномерно в [30000, 100000)
+        }
+    });
+
+    return table;
+}
+
+// Средняя зарплата по кодам отделов; у отдела без сотрудников - NaN
+using DeptAverages = vector<double>;
+
+// Вычислительные ядра двух горячих циклов: сумма и количество по группам и отбор
+// строк с зарплатой выше средней по отделу. Векторные версии AVX2 и AVX-512
+// компилируются через атрибут target и выбираются во время выполнения по
+// возможностям процессора (kernel_set.h), как PrintableFiller в fast_random.h.
+
+// Больше групп векторные ядра суммирования не держат в регистрах; тогда - скалярное
+constexpr size_t maxSimdGroups = 8;
+
+void groupSumScalar(const double* salary, const DeptCode* dept, size_t n, double* sum, int64_t* count) {
+    for (size_t i = 0; i < n; ++i) {
+        sum[dept[i]] += salary[i];
+        count[dept[i]]++;
     }
+}
 
-    map<string, double> averageSalary; // Средняя зарплата по отделам
-    // Рассчитываем среднюю зарплату для каждого отдела
-    for (const auto& pair : totalSalary) {
-        averageSalary[pair.first] = pair.second / count[pair.first];
+// Отбор в битовую карту: бит i слова w - строка 64 * w + i. Без ветвлений по строкам.
+void filterAboveScalar(const double* salary, const DeptCode* dept, size_t n, const double* avg, uint64_t* bits) {
+    for (size_t w = 0; w * 64 < n; ++w) {
+        size_t end = min(n, (w + 1) * 64);
+        uint64_t word = 0;
+        for (size_t i = w * 64; i < end; ++i) {
+            word |= static_cast<uint64_t>(salary[i] > avg[dept[i]]) << (i & 63);
+        }
+        bits[w] = word;
     }
+}
 
-    return averageSalary;
+#ifdef KERNEL_SET_X86
+// Количество строк по G группам: 32 кода за шаг сравниваются побайтно, совпадения
+// копятся в байтовых счетчиках и раз в 255 шагов сбрасываются через _mm256_sad_epu8
+template <size_t G>
+__attribute__((target("avx2"))) size_t groupCountAvx2(const DeptCode* dept, size_t n, int64_t* count) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i + 32 <= n) {
+        size_t steps = min<size_t>((n - i) / 32, 255);
+        __m256i counts[G];
+        for (size_t g = 0; g < G; ++g) {
+            counts[g] = zero;
+        }
+        for (size_t step = 0; step < steps; ++step, i += 32) {
+            __m256i codes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dept + i));
+            // Полная развертка по группам: без нее при -O2 аккумуляторы остаются в памяти
+#pragma GCC unroll 8
+            for (size_t g = 0; g < G; ++g) {
+                counts[g] = _mm256_sub_epi8(counts[g], _mm256_cmpeq_epi8(codes, _mm256_set1_epi8(static_cast<char>(g))));
+            }
+        }
+        for (size_t g = 0; g < G; ++g) {
+            alignas(32) int64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_sad_epu8(counts[g], zero));
+            count[g] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+    }
+    return i;
+}
+
+// Сумма по G группам: для каждой группы маска совпадения кодов и маскированное
+// сложение. Количества считаются отдельным проходом по байтам кодов, чтобы
+// аккумуляторы сумм всех групп помещались в регистры.
+template <size_t G>
+__attribute__((target("avx2"))) void groupSumAvx2(const double* salary, const DeptCode* dept, size_t n, double* sum,
+                                                  int64_t* count) {
+    __m256d sums[G];
+    for (size_t g = 0; g < G; ++g) {
+        sums[g] = _mm256_setzero_pd();
+    }
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t packed;
+        memcpy(&packed, dept + i, sizeof(packed));
+        __m256i codes = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(packed)));
+        __m256d values = _mm256_loadu_pd(salary + i);
+#pragma GCC unroll 8
+        for (size_t g = 0; g < G; ++g) {
+            __m256i match = _mm256_cmpeq_epi64(codes, _mm256_set1_epi64x(static_cast<int64_t>(g)));
+            sums[g] = _mm256_add_pd(sums[g], _mm256_and_pd(values, _mm256_castsi256_pd(match)));
+        }
+    }
+    for (size_t g = 0; g < G; ++g) {
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, sums[g]);
+        sum[g] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    for (; i < n; ++i) {
+        sum[dept[i]] += salary[i];
+    }
+    for (size_t j = groupCountAvx2<G>(dept, n, count); j < n; ++j) {
+        count[dept[j]]++;
+    }
+}
+
+template <size_t G>
+__attribute__((target("avx512f"))) void groupSumAvx512(const double* salary, const DeptCode* dept, size_t n,
+                                                       double* sum, int64_t* count) {
+    __m512d sums[G];
+    __m512i counts[G];
+    for (size_t g = 0; g < G; ++g) {
+        sums[g] = _mm512_setzero_pd();
+        counts[g] = _mm512_setzero_si512();
+    }
+    const __m512i one = _mm512_set1_epi64(1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // maskz-форма вместо _mm512_cvtepu8_epi64: та же причина, что у gather ниже
+        __m512i codes = _mm512_maskz_cvtepu8_epi64(0xFF, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(dept + i)));
+        __m512d values = _mm512_loadu_pd(salary + i);
+#pragma GCC unroll 8
+        for (size_t g = 0; g < G; ++g) {
+            __mmask8 match = _mm512_cmpeq_epi64_mask(codes, _mm512_set1_epi64(static_cast<int64_t>(g)));
+            sums[g] = _mm512_mask_add_pd(sums[g], match, sums[g], values);
+            counts[g] = _mm512_mask_add_epi64(counts[g], match, counts[g], one);
+        }
+    }
+    for (size_t g = 0; g < G; ++g) {
+        alignas(64) double laneSums[8];
+        alignas(64) int64_t laneCounts[8];
+        _mm512_store_pd(laneSums, sums[g]);
+        _mm512_store_si512(laneCounts, counts[g]);
+        double total = 0;
+        for (size_t lane = 0; lane < 8; ++lane) {
+            total += laneSums[lane];
+            count[g] += laneCounts[lane];
+        }
+        sum[g] += total;
+    }
+    groupSumScalar(salary + i, dept + i, n - i, sum, count);
+}
+
+// Отбор: средние отделов подбираются gather по кодам, сравнение дает 4 бита за шаг.
+// Маскированные формы gather - из-за ложных предупреждений в заголовках GCC 12.
+__attribute__((target("avx2"))) void filterAboveAvx2(const double* salary, const DeptCode* dept, size_t n,
+                                                     const double* avg, uint64_t* bits) {
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t fullWords = n / 64;
+    for (size_t w = 0; w < fullWords; ++w) {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            size_t i = w * 64 + j * 4;
+            uint32_t packed;
+            memcpy(&packed, dept + i, sizeof(packed));
+            __m128i codes = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(packed)));
+            __m256d threshold = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), avg, codes, allLanes, 8);
+            __m256d above = _mm256_cmp_pd(_mm256_loadu_pd(salary + i), threshold, _CMP_GT_OQ);
+            word |= static_cast<uint64_t>(_mm256_movemask_pd(above)) << (j * 4);
+        }
+        bits[w] = word;
+    }
+    filterAboveScalar(salary + fullWords * 64, dept + fullWords * 64, n - fullWords * 64, avg, bits + fullWords);
+}
+
+__attribute__((target("avx512f"))) void filterAboveAvx512(const double* salary, const DeptCode* dept, size_t n,
+                                                          const double* avg, uint64_t* bits) {
+    size_t fullWords = n / 64;
+    for (size_t w = 0; w < fullWords; ++w) {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 8; ++j) {
+            size_t i = w * 64 + j * 8;
+            __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(dept + i)));
+            __m512d threshold = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, codes, avg, 8);
+            __mmask8 above = _mm512_cmp_pd_mask(_mm512_loadu_pd(salary + i), threshold, _CMP_GT_OQ);
+            word |= static_cast<uint64_t>(above) << (j * 8);
+        }
+        bits[w] = word;
+    }
+    filterAboveScalar(salary + fullWords * 64, dept + fullWords * 64, n - fullWords * 64, avg, bits + fullWords);
+}
+#endif
+
+// Сумма и количество по группам с выбором ядра
+void groupSum(const double* salary, const DeptCode* dept, size_t n, size_t numGroups, double* sum, int64_t* count) {
+#ifdef KERNEL_SET_X86
+    if (numGroups <= maxSimdGroups && activeKernels != KernelSet::Scalar) {
+        using Fn = void (*)(const double*, const DeptCode*, size_t, double*, int64_t*);
+        static constexpr Fn avx2[maxSimdGroups + 1] = {nullptr,           groupSumAvx2<1>, groupSumAvx2<2>,
+                                                       groupSumAvx2<3>,   groupSumAvx2<4>, groupSumAvx2<5>,
+                                                       groupSumAvx2<6>,   groupSumAvx2<7>, groupSumAvx2<8>};
+        static constexpr Fn avx512[maxSimdGroups + 1] = {nullptr,           groupSumAvx512<1>, groupSumAvx512<2>,
+                                                         groupSumAvx512<3>, groupSumAvx512<4>, groupSumAvx512<5>,
+                                                         groupSumAvx512<6>, groupSumAvx512<7>, groupSumAvx512<8>};
+        if (numGroups > 0) {
+            (activeKernels == KernelSet::Avx512 ? avx512 : avx2)[numGroups](salary, dept, n, sum, count);
+            return;
+        }
+    }
+#endif
+    groupSumScalar(salary, dept, n, sum, count);
+}
+
+// Битовая карта строк с зарплатой выше средней по отделу; bits - (n + 63) / 64 слов
+void filterAbove(const double* salary, const DeptCode* dept, size_t n, const double* avg, uint64_t* bits) {
+#ifdef KERNEL_SET_X86
+    if (activeKernels == KernelSet::Avx512) {
+        filterAboveAvx512(salary, dept, n, avg, bits);
+        return;
+    }
+    if (activeKernels == KernelSet::Avx2) {
+        filterAboveAvx2(salary, dept, n, avg, bits);
+        return;
+    }
+#endif
+    filterAboveScalar(salary, dept, n, avg, bits);
+}
+
+// Суммы и количества по кодам отделов
+struct DeptTotals {
+    vector<double> totalSalary; // Сумма зарплат по отделам
+    vector<int64_t> count;      // Количество сотрудников по отделам
+
+    explicit DeptTotals(size_t numDepartments = 0) : totalSalary(numDepartments), count(numDepartments) {}
+
+    // Добавить строки [begin, end); группировка - индекс массива по коду отдела
+    void accumulate(const EmployeeTable& employees, size_t begin, size_t end) {
+        groupSum(employees.salary.data() + begin, employees.department.data() + begin, end - begin,
+                 totalSalary.size(), totalSalary.data(), count.data());
+    }
+
+    void merge(const DeptTotals& other) {
+        for (size_t d = 0; d < totalSalary.size(); ++d) {
+            totalSalary[d] += other.totalSalary[d];
+            count[d] += other.count[d];
+        }
+    }
+
+    DeptAverages averages() const {
+        DeptAverages averageSalary(totalSalary.size());
+        for (size_t d = 0; d < totalSalary.size(); ++d) {
+            averageSalary[d] = count[d] > 0 ? totalSalary[d] / count[d] : NAN;
+        }
+        return averageSalary;
+    }
+};
+
+// Функция для расчета средней зарплаты по отделам (однопоточная версия)
+DeptAverages calculateAverageSalary(const EmployeeTable& employees) {
+    DeptTotals totals(employees.departmentDict.size());
+    totals.accumulate(employees, 0, employees.size());
+    return totals.averages();
+}
+
+// Окончание строки вывода: должность, отдел и зарплата
+void appendEmployeeTail(string& out, string_view position, string_view department, double salaryValue) {
+    char salary[32];
+    snprintf(salary, sizeof(salary), "%g", salaryValue); // Тот же формат, что у cout по умолчанию
+    out += ", Должность: ";
+    out += position;
+    out += ", Отдел: ";
+    out += department;
+    out += ", Зарплата: ";
+    out += salary;
+    out += '\n';
+}
+
+// Запись журнала о сотруднике; таблица должна жить до AsyncLog::flush()
+struct EmployeeRow {
+    const EmployeeTable* table;
+    size_t row;
+};
+
+// Форматирование строки вывода (выполняется фоновым потоком журнала)
+void formatEmployeeRow(string& out, const EmployeeRow& entry) {
+    const EmployeeTable& t = *entry.table;
+    size_t row = entry.row;
+    out += "ФИО: ";
+    out += t.surnameDict.at(t.surname[row]);
+    out += ' ';
+    out += t.nameDict.at(t.name[row]);
+    out += ' ';
+    out += t.patronymicDict.at(t.patronymic[row]);
+    appendEmployeeTail(out, t.positionDict.at(t.position[row]), t.departmentDict.at(t.department[row]), t.salary[row]);
+}
+
+// Битовая карта сотрудников, у которых зарплата выше средней по отделу
+vector<uint64_t> selectAboveAverage(const EmployeeTable& employees, const DeptAverages& averageSalary) {
+    vector<uint64_t> bits((employees.size() + 63) / 64);
+    filterAbove(employees.salary.data(), employees.department.data(), employees.size(), averageSalary.data(),
+                bits.data());
+    return bits;
 }
 
 // Функция для вывода сотрудников, у которых зарплата выше средней по отделу
-void printEmployeesAboveAverage(const vector<Employee>& employees, const map<string, double>& averageSalary) {
-    // Проходим по всем сотрудникам и выводим тех, у кого зарплата выше средней по отделу
-    for (const auto& emp : employees) {
-        if (emp.salary > averageSalary.at(emp.department)) {
-            cout << "ФИО: " << emp.fio << ", Должность: " << emp.position << ", Отдел: " << emp.department << ", Зарплата: " << emp.salary << endl;
+void printEmployeesAboveAverage(const EmployeeTable& employees, const DeptAverages& averageSalary) {
+    vector<uint64_t> bits = selectAboveAverage(employees, averageSalary);
+    // Выводим строки, отмеченные в битовой карте
+    for (size_t w = 0; w < bits.size(); ++w) {
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+            size_t row = w * 64 + countr_zero(word);
+            AsyncLog::instance().write(formatEmployeeRow, EmployeeRow{&employees, row});
+        }
+    }
+    AsyncLog::instance().flush(); // Строки ссылаются на таблицу, поэтому дожидаемся вывода
+}
+
+// Частичный агрегат одного потока. Выравнивание разводит заголовки по строкам кэша,
+// а массивы выделяет сам поток, так что соседние потоки не пишут в общие строки.
+struct alignas(64) DeptPartial {
+    DeptTotals totals;
+};
+
+// Функция для расчета средней зарплаты по отделам в многопоточной версии.
+// Потоки берут блоки по chunkRows строк из общего счетчика (динамическое планирование:
+// медленный поток просто возьмет меньше блоков) и копят суммы в своих агрегатах.
+// Затем агрегаты сливаются деревом за log2(numThreads) раундов: в раунде со
+// смещением step поток t, кратный 2 * step, забирает агрегат потока t + step.
+DeptAverages calculateAverageSalaryParallel(const EmployeeTable& employees, int numThreads, size_t chunkRows = 1 << 16) {
+    size_t numDepartments = employees.departmentDict.size();
+    size_t numRows = employees.size();
+    vector<DeptPartial> partials(numThreads);
+    atomic<size_t> nextRow{0};
+    std::barrier<> roundDone(numThreads);
+
+    auto worker = [&](int t) {
+        DeptTotals& mine = partials[t].totals;
+        mine = DeptTotals(numDepartments);
+        while (true) {
+            size_t begin = nextRow.fetch_add(chunkRows, memory_order_relaxed);
+            if (begin >= numRows) {
+                break;
+            }
+            mine.accumulate(employees, begin, min(numRows, begin + chunkRows));
+        }
+        for (int step = 1; step < numThreads; step *= 2) {
+            roundDone.arrive_and_wait(); // Агрегаты предыдущего раунда готовы
+            if (t % (2 * step) == 0 && t + step < numThreads) {
+                mine.merge(partials[t + step].totals);
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < numThreads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0); // Вызывающий поток работает наравне с остальными
+    for (auto& t : threads) {
+        t.join();
+    }
+    return partials[0].totals.averages();
+}
+
+// Воспроизводимые средние: суммы считаются по блокам фиксированного размера (каждый
+// блок одним вызовом accumulate), а блоки складываются попарно в порядке номеров.
+// Порядок всех сложений задан только размером данных и blockRows, поэтому результат
+// побитно одинаков при любом числе потоков и любом распределении блоков между ними.
+template <typename Accumulate>
+DeptAverages reproducibleAverages(size_t numRows, size_t numDepartments, int numThreads, size_t blockRows,
+                                  Accumulate&& accumulate) {
+    size_t numBlocks = (numRows + blockRows - 1) / blockRows;
+    if (numBlocks == 0) {
+        return DeptTotals(numDepartments).averages();
+    }
+    vector<DeptTotals> blocks(numBlocks, DeptTotals(numDepartments));
+    parallelForDynamic(numThreads, numBlocks, [&](int, size_t b) {
+        accumulate(b * blockRows, min(numRows, (b + 1) * blockRows), blocks[b]);
+    });
+    for (size_t step = 1; step < numBlocks; step *= 2) {
+        for (size_t b = 0; b + step < numBlocks; b += 2 * step) {
+            blocks[b].merge(blocks[b + step]);
+        }
+    }
+    return blocks[0].averages();
+}
+
+DeptAverages calculateAverageSalaryReproducible(const EmployeeTable& employees, int numThreads,
+                                                size_t blockRows = 1 << 16) {
+    return reproducibleAverages(employees.size(), employees.departmentDict.size(), numThreads, blockRows,
+                                [&](size_t begin, size_t end, DeptTotals& totals) {
+                                    totals.accumulate(employees, begin, end);
+                                });
+}
+
+// Наибольшее относительное расхождение средних; NaN совпадает с NaN
+double maxRelativeDifference(const DeptAverages& a, const DeptAverages& b) {
+    double worst = 0;
+    for (size_t d = 0; d < a.size(); ++d) {
+        if (isnan(a[d]) || isnan(b[d])) {
+            if (isnan(a[d]) != isnan(b[d])) {
+                return INFINITY;
+            }
+            continue;
+        }
+        worst = max(worst, fabs(a[d] - b[d]) / max(fabs(a[d]), 1.0));
+    }
+    return worst;
+}
+
+// Скетч квантилей KLL (Karnin, Lang, Liberty): уровни-компакторы, элемент уровня h
+// весит 2^h. Переполненный уровень сортируется, и каждый второй элемент (начиная со
+// случайного) поднимается на уровень выше. Емкость уровня - k * (2/3)^(глубина), всего
+// хранится около 3k чисел при любом числе строк, а ошибка ранга - порядка 1/k.
+// Скетчи сливаются поуровнево, поэтому потоки строят свои и сливают в конце.
+class KllSketch {
+public:
+    explicit KllSketch(uint32_t k = 200, uint64_t seed = 0) : k(max<uint32_t>(k, 8)), coin(seed) {
+        addLevel();
+    }
+
+    void add(double x) {
+        levels[0].push_back(x);
+        ++n;
+        if (levels[0].size() >= capacities[0]) {
+            compress();
+        }
+    }
+
+    void merge(const KllSketch& other) {
+        while (levels.size() < other.levels.size()) {
+            addLevel();
+        }
+        for (size_t h = 0; h < other.levels.size(); ++h) {
+            levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        }
+        n += other.n;
+        compress();
+    }
+
+    // Значения для долей qs: наименьшее x, у которого оценка ранга не меньше q * n
+    vector<double> quantiles(const vector<double>& qs) const {
+        vector<pair<double, uint64_t>> weighted;
+        for (size_t h = 0; h < levels.size(); ++h) {
+            for (double x : levels[h]) {
+                weighted.push_back({x, uint64_t(1) << h});
+            }
+        }
+        sort(weighted.begin(), weighted.end());
+        vector<double> result;
+        for (double q : qs) {
+            double target = q * static_cast<double>(n);
+            uint64_t rank = 0;
+            double value = NAN;
+            for (const auto& [x, weight] : weighted) {
+                rank += weight;
+                value = x;
+                if (static_cast<double>(rank) >= target) {
+                    break;
+                }
+            }
+            result.push_back(value);
+        }
+        return result;
+    }
+
+    uint64_t count() const {
+        return n;
+    }
+
+    // Хранимых чисел: не зависит от count()
+    size_t retained() const {
+        size_t total = 0;
+        for (const auto& level : levels) {
+            total += level.size();
+        }
+        return total;
+    }
+
+    // Ожидаемая нормированная ошибка ранга одного квантиля (эмпирическая формула
+    // DataSketches для уровня доверия 99%)
+    static double rankErrorBound(uint32_t k) {
+        return 2.296 / pow(static_cast<double>(k), 0.9723);
+    }
+
+private:
+    void addLevel() {
+        levels.emplace_back();
+        capacities.resize(levels.size());
+        for (size_t h = 0; h < levels.size(); ++h) {
+            double depth = static_cast<double>(levels.size() - 1 - h);
+            capacities[h] = max<uint32_t>(minCapacity, static_cast<uint32_t>(ceil(k * pow(2.0 / 3.0, depth))));
+        }
+    }
+
+    void compress() {
+        for (size_t h = 0; h < levels.size(); ++h) {
+            if (levels[h].size() < capacities[h]) {
+                continue;
+            }
+            if (h + 1 == levels.size()) {
+                addLevel();
+            }
+            vector<double>& level = levels[h];
+            sort(level.begin(), level.end());
+            size_t odd = level.size() % 2; // Нечетный элемент остается на своем уровне
+            size_t paired = level.size() - odd;
+            for (size_t i = coin() & 1; i < paired; i += 2) {
+                levels[h + 1].push_back(level[i]);
+            }
+            if (odd) {
+                level[0] = level.back();
+            }
+            level.resize(odd);
+        }
+    }
+
+    // Нижние уровни не сжимаются до пары чисел: иначе сортировка на каждой второй вставке
+    static constexpr uint32_t minCapacity = 8;
+
+    uint32_t k;
+    uint64_t n = 0;
+    Xoshiro256 coin;
+    vector<vector<double>> levels;
+    vector<uint32_t> capacities;
+};
+
+// Доли квантилей в отчете: медиана, p90, p99
+const vector<double> reportedQuantiles = {0.5, 0.9, 0.99};
+
+// Квантили зарплат по кодам отделов (строка - отдел, столбец - доля из reportedQuantiles)
+using DeptQuantiles = vector<vector<double>>;
+
+// Частичные скетчи одного потока
+struct alignas(64) DeptSketches {
+    vector<KllSketch> sketches;
+};
+
+// Квантили зарплат по отделам за один проход: потоки берут блоки строк динамически и
+// копят свои скетчи по отделам, затем скетчи сливаются деревом, как в
+// calculateAverageSalaryParallel. Память - O(потоки * отделы * k) при любом числе строк.
+DeptQuantiles calculateSalaryQuantilesParallel(const EmployeeTable& employees, int numThreads, uint32_t k,
+                                               size_t chunkRows = 1 << 16) {
+    size_t numDepartments = employees.departmentDict.size();
+    size_t numRows = employees.size();
+    vector<DeptSketches> partials(numThreads);
+    atomic<size_t> nextRow{0};
+    std::barrier<> roundDone(numThreads);
+
+    auto worker = [&](int t) {
+        vector<KllSketch>& mine = partials[t].sketches;
+        for (size_t d = 0; d < numDepartments; ++d) {
+            mine.emplace_back(k, generatorBlockSeed(t, d)); // Свои монеты у каждого скетча
+        }
+        while (true) {
+            size_t begin = nextRow.fetch_add(chunkRows, memory_order_relaxed);
+            if (begin >= numRows) {
+                break;
+            }
+            size_t end = min(numRows, begin + chunkRows);
+            for (size_t i = begin; i < end; ++i) {
+                mine[employees.department[i]].add(employees.salary[i]);
+            }
+        }
+        for (int step = 1; step < numThreads; step *= 2) {
+            roundDone.arrive_and_wait();
+            if (t % (2 * step) == 0 && t + step < numThreads) {
+                for (size_t d = 0; d < numDepartments; ++d) {
+                    mine[d].merge(partials[t + step].sketches[d]);
+                }
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < numThreads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    DeptQuantiles result;
+    for (const auto& sketch : partials[0].sketches) {
+        result.push_back(sketch.count() > 0 ? sketch.quantiles(reportedQuantiles)
+                                            : vector<double>(reportedQuantiles.size(), NAN));
+    }
+    return result;
+}
+
+// Точные квантили для проверки: зарплаты отделов сортируются целиком, O(n) памяти.
+// Заодно возвращает отсортированные зарплаты, чтобы оценить ранг ответа скетча.
+DeptQuantiles calculateSalaryQuantilesExact(const EmployeeTable& employees, vector<vector<double>>& sorted) {
+    sorted.assign(employees.departmentDict.size(), {});
+    for (size_t i = 0; i < employees.size(); ++i) {
+        sorted[employees.department[i]].push_back(employees.salary[i]);
+    }
+    DeptQuantiles result;
+    for (auto& values : sorted) {
+        sort(values.begin(), values.end());
+        vector<double> row;
+        for (double q : reportedQuantiles) {
+            if (values.empty()) {
+                row.push_back(NAN);
+                continue;
+            }
+            size_t rank = static_cast<size_t>(ceil(q * values.size()));
+            row.push_back(values[min(values.size(), max<size_t>(rank, 1)) - 1]);
+        }
+        result.push_back(row);
+    }
+    return result;
+}
+
+// Нормированная ошибка ранга: на какую долю строк ранг оценки отличается от ранга точного ответа
+double rankError(const vector<double>& sorted, double estimate, double exact) {
+    auto rank = [&](double value) {
+        return static_cast<double>(upper_bound(sorted.begin(), sorted.end(), value) - sorted.begin());
+    };
+    return fabs(rank(estimate) - rank(exact)) / sorted.size();
+}
+
+// Сумма с компенсацией (Kahan-Babuska-Neumaier): вычитание - прибавление с минусом,
+// поэтому после миллионов вставок и удалений сумма не уплывает от точной
+class CompensatedSum {
+public:
+    void add(double x) {
+        double t = sum + x;
+        compensation += fabs(sum) >= fabs(x) ? (sum - t) + x : (x - t) + sum;
+        sum = t;
+    }
+
+    double value() const {
+        return sum + compensation;
+    }
+
+private:
+    double sum = 0;
+    double compensation = 0;
+};
+
+// Упорядоченное по зарплате множество строк отдела с порядковой статистикой:
+// число строк выше порога - order_of_key за O(log n)
+using SalaryIndex = __gnu_pbds::tree<pair<double, uint32_t>, __gnu_pbds::null_type, less<pair<double, uint32_t>>,
+                                     __gnu_pbds::rb_tree_tag, __gnu_pbds::tree_order_statistics_node_update>;
+
+// Оперативный режим: строки вставляются, меняются и удаляются, а сумма и количество
+// по отделам обновляются на месте. У каждого отдела свой индекс по зарплате, и
+// «выше средней» - это диапазон от upper_bound(средняя) до конца индекса.
+class OnlineSalaryStats {
+public:
+    // Индекс по готовой таблице; удаленные строки остаются в таблице до повторного использования
+    explicit OnlineSalaryStats(EmployeeTable tableValue) : table(std::move(tableValue)) {
+        if (table.size() > numeric_limits<uint32_t>::max()) {
+            throw length_error("Слишком много строк для оперативного индекса");
+        }
+        alive.assign(table.size(), 1);
+        growDepartments();
+        for (size_t row = 0; row < table.size(); ++row) {
+            link(static_cast<uint32_t>(row));
+        }
+    }
+
+    uint32_t insert(const string& surname, const string& name, const string& patronymic, const string& position,
+                    const string& department, double salary) {
+        uint32_t row;
+        if (freeRows.empty()) {
+            row = static_cast<uint32_t>(table.size());
+            table.append(surname, name, patronymic, position, department, salary);
+            alive.push_back(1);
+        } else {
+            row = freeRows.back();
+            freeRows.pop_back();
+            table.surname[row] = table.surnameDict.intern(surname);
+            table.name[row] = table.nameDict.intern(name);
+            table.patronymic[row] = table.patronymicDict.intern(patronymic);
+            table.position[row] = table.positionDict.intern(position);
+            table.department[row] = table.departmentDict.intern(department);
+            table.salary[row] = salary;
+            alive[row] = 1;
+        }
+        growDepartments();
+        link(row);
+        return row;
+    }
+
+    // Перевод в другой отдел и/или новая зарплата
+    void update(uint32_t row, const string& department, double salary) {
+        checkAlive(row);
+        unlink(row);
+        table.department[row] = table.departmentDict.intern(department);
+        table.salary[row] = salary;
+        growDepartments();
+        link(row);
+    }
+
+    void updateSalary(uint32_t row, double salary) {
+        checkAlive(row);
+        unlink(row);
+        table.salary[row] = salary;
+        link(row);
+    }
+
+    void remove(uint32_t row) {
+        checkAlive(row);
+        unlink(row);
+        alive[row] = 0;
+        freeRows.push_back(row);
+    }
+
+    bool isAlive(uint32_t row) const {
+        return row < alive.size() && alive[row];
+    }
+
+    DeptAverages averages() const {
+        DeptAverages result(departments.size());
+        for (size_t d = 0; d < departments.size(); ++d) {
+            result[d] = departments[d].index.empty() ? NAN : departments[d].sum.value() / departments[d].index.size();
+        }
+        return result;
+    }
+
+    // Количество строк выше средней своего отдела за O(число отделов * log n)
+    size_t countAboveAverage() const {
+        size_t total = 0;
+        for (const auto& dept : departments) {
+            if (!dept.index.empty()) {
+                double average = dept.sum.value() / dept.index.size();
+                total += dept.index.size() - dept.index.order_of_key({average, numeric_limits<uint32_t>::max()});
+            }
+        }
+        return total;
+    }
+
+    // Строки выше средней своего отдела: по отделам, внутри отдела по возрастанию зарплаты
+    template <typename Callback>
+    void forEachAboveAverage(Callback&& callback) const {
+        for (const auto& dept : departments) {
+            if (!dept.index.empty()) {
+                double average = dept.sum.value() / dept.index.size();
+                for (auto it = dept.index.upper_bound({average, numeric_limits<uint32_t>::max()});
+                     it != dept.index.end(); ++it) {
+                    callback(it->second);
+                }
+            }
+        }
+    }
+
+    const EmployeeTable& rows() const {
+        return table;
+    }
+
+    // Живых строк
+    size_t size() const {
+        return table.size() - freeRows.size();
+    }
+
+private:
+    struct Department {
+        CompensatedSum sum;
+        SalaryIndex index;
+    };
+
+    void growDepartments() {
+        departments.resize(table.departmentDict.size());
+    }
+
+    void link(uint32_t row) {
+        Department& dept = departments[table.department[row]];
+        dept.sum.add(table.salary[row]);
+        dept.index.insert({table.salary[row], row});
+    }
+
+    void unlink(uint32_t row) {
+        Department& dept = departments[table.department[row]];
+        dept.sum.add(-table.salary[row]);
+        dept.index.erase({table.salary[row], row});
+    }
+
+    void checkAlive(uint32_t row) const {
+        if (!isAlive(row)) {
+            throw out_of_range("Нет строки " + to_string(row));
+        }
+    }
+
+    EmployeeTable table;
+    vector<char> alive;
+    vector<uint32_t> freeRows;
+    vector<Department> departments;
+};
+
+// Эталон для оперативного режима: полный пересчет по живым строкам
+size_t countAboveAverageRescan(const OnlineSalaryStats& stats, DeptAverages& averages) {
+    const EmployeeTable& t = stats.rows();
+    DeptTotals totals(t.departmentDict.size());
+    for (uint32_t row = 0; row < t.size(); ++row) {
+        if (stats.isAlive(row)) {
+            totals.totalSalary[t.department[row]] += t.salary[row];
+            totals.count[t.department[row]]++;
+        }
+    }
+    averages = totals.averages();
+    size_t count = 0;
+    for (uint32_t row = 0; row < t.size(); ++row) {
+        count += stats.isAlive(row) && t.salary[row] > averages[t.department[row]];
+    }
+    return count;
+}
+
+// Случайный поток изменений: 40% новых зарплат, 20% переводов, 20% вставок, 20% удалений;
+// после каждого изменения - запрос числа строк выше средней
+void runOnlineWorkload(OnlineSalaryStats& stats, size_t numChanges, uint64_t seed) {
+    Xoshiro256 gen(seed ^ 0x6f6e6c696e65ULL);
+    size_t checksum = 0;
+    auto randomRow = [&]() {
+        uint32_t row;
+        do {
+            row = gen.nextBelow(static_cast<uint32_t>(stats.rows().size()));
+        } while (!stats.isAlive(row));
+        return row;
+    };
+    auto randomSalary = [&]() {
+        return 30000 + 70000 * gen.nextDouble();
+    };
+
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < numChanges; ++k) {
+        uint32_t kind = gen.nextBelow(5);
+        if (stats.size() == 0) {
+            kind = 3;
+        }
+        if (kind <= 1) {
+            stats.updateSalary(randomRow(), randomSalary());
+        } else if (kind == 2) {
+            stats.update(randomRow(), departments[gen.nextBelow(departments.size())], randomSalary());
+        } else if (kind == 3) {
+            stats.insert(surnames[gen.nextBelow(surnames.size())], names[gen.nextBelow(names.size())],
+                         patronymics[gen.nextBelow(patronymics.size())], positions[gen.nextBelow(positions.size())],
+                         departments[gen.nextBelow(departments.size())], randomSalary());
+        } else {
+            stats.remove(randomRow());
         }
+        checksum += stats.countAboveAverage();
+    }
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    cout << "Оперативный режим: изменений " << numChanges << " за " << elapsed.count() << " сек ("
+         << (numChanges > 0 ? elapsed.count() * 1e6 / numChanges : 0) << " мкс на изменение с запросом)" << endl;
+
+    start = chrono::high_resolution_clock::now();
+    DeptAverages reference;
+    size_t expected = countAboveAverageRescan(stats, reference);
+    elapsed = chrono::high_resolution_clock::now() - start;
+    cout << "Полный пересчет для сравнения: " << elapsed.count() << " сек" << endl;
+
+    size_t actual = stats.countAboveAverage();
+    double difference = maxRelativeDifference(stats.averages(), reference);
+    if (actual != expected || difference > 1e-12) {
+        throw runtime_error("Оперативная статистика разошлась с пересчетом: строк " + to_string(actual) +
+                            " против " + to_string(expected));
     }
+    cout << "Строк: " << stats.size() << ", выше средней: " << actual << " (контрольная сумма запросов " << checksum
+         << ")" << endl;
 }
 
-// Функция для расчета средней зарплаты по отделам в многопоточной версии
-void calculateAverageSalaryThread(const vector<Employee>& employees, map<string, atomic<double>>& totalSalary, map<string, atomic<int>>& count, int start, int end) {
-    // Проходим по диапазону сотрудников, заданному параметрами start и end
-    for (int i = start; i < end; ++i) {
-        const auto& emp = employees[i];
-        double currentSalary = totalSalary[emp.department].load(memory_order_relaxed);
-        // Используем атомарные операции для безопасного добавления зарплаты
-        while (!totalSalary[emp.department].compare_exchange_weak(currentSalary, currentSalary + emp.salary, memory_order_relaxed)) {}
-        count[emp.department].fetch_add(1, memory_order_relaxed);
+// Файл, отображенный в память только для чтения. Страницы подгружаются по мере
+// чтения и остаются чистыми, поэтому ядро вытесняет их без записи: в памяти
+// одновременно находится только рабочая часть файла.
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Не удалось открыть " + path + ": " + strerror(errno));
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int code = errno;
+            close(fd);
+            throw runtime_error("Не удалось получить размер " + path + ": " + strerror(code));
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                int code = errno;
+                close(fd);
+                throw runtime_error("Не удалось отобразить " + path + ": " + strerror(code));
+            }
+            madvise(addr, length, MADV_SEQUENTIAL); // Чтение подряд: ядро читает вперед
+        }
+    }
+
+    ~MappedFile() {
+        if (addr) {
+            munmap(addr, length);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {
+        return static_cast<const char*>(addr);
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    int fd = -1;
+    void* addr = nullptr;
+    size_t length = 0;
+};
+
+// Размер блока входного файла, который обрабатывает один поток за раз
+constexpr size_t ingestChunkBytes = 4 << 20;
+
+// Заголовок CSV; строки - "Фамилия Имя Отчество,Должность,Отдел,Зарплата"
+constexpr string_view csvHeader = "fio,position,department,salary";
+
+// Поля строки CSV - фрагменты отображенного файла
+struct CsvRow {
+    string_view fio;
+    string_view position;
+    string_view department;
+    double salary;
+};
+
+// Разбор строки [begin, end) без перевода строки; false - строка некорректна
+bool parseCsvRow(const char* begin, const char* end, CsvRow& row) {
+    string_view fields[3];
+    const char* p = begin;
+    for (auto& field : fields) {
+        const char* comma = static_cast<const char*>(memchr(p, ',', end - p));
+        if (!comma) {
+            return false;
+        }
+        field = string_view(p, comma - p);
+        p = comma + 1;
+    }
+    if (end > p && end[-1] == '\r') {
+        --end;
+    }
+    auto [ptr, ec] = from_chars(p, end, row.salary);
+    if (ec != errc() || ptr != end) {
+        return false;
     }
+    row.fio = fields[0];
+    row.position = fields[1];
+    row.department = fields[2];
+    return true;
 }
 
-int main() {
+// Обход строк CSV в [begin, end); пустые строки пропускаются
+template <typename Callback>
+void forEachCsvRow(const char* data, size_t begin, size_t end, Callback&& callback) {
+    const char* p = data + begin;
+    const char* stop = data + end;
+    while (p < stop) {
+        const char* newline = static_cast<const char*>(memchr(p, '\n', stop - p));
+        const char* lineEnd = newline ? newline : stop;
+        if (lineEnd > p && !(lineEnd - p == 1 && *p == '\r')) {
+            CsvRow row;
+            if (!parseCsvRow(p, lineEnd, row)) {
+                throw runtime_error("Некорректная строка CSV со смещения " + to_string(p - data));
+            }
+            callback(row, p, static_cast<size_t>(lineEnd - p));
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// Границы блоков CSV: примерно по chunkBytes, каждая сдвинута на начало следующей строки
+vector<size_t> splitCsvChunks(const char* data, size_t size, size_t begin, size_t chunkBytes) {
+    vector<size_t> bounds = {begin};
+    while (bounds.back() < size) {
+        size_t next = bounds.back() + chunkBytes;
+        if (next >= size) {
+            bounds.push_back(size);
+            break;
+        }
+        const char* newline = static_cast<const char*>(memchr(data + next, '\n', size - next));
+        bounds.push_back(newline ? static_cast<size_t>(newline - data) + 1 : size);
+    }
+    return bounds;
+}
+
+// Строка двоичного файла: коды словарей и зарплата, 16 байт, как строка EmployeeTable
+struct PackedRow {
+    double salary;
+    uint16_t surname;
+    uint16_t name;
+    uint16_t patronymic;
+    uint8_t position;
+    DeptCode department;
+};
+static_assert(sizeof(PackedRow) == 16, "Строка двоичного файла занимает 16 байт");
+
+// Последовательное чтение отображенного файла с проверкой границ
+class FileReader {
+public:
+    FileReader(const MappedFile& file, size_t pos) : file(file), pos(pos) {}
+
+    template <typename T>
+    T read() {
+        need(sizeof(T));
+        T value;
+        memcpy(&value, file.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    string_view readBytes(size_t length) {
+        need(length);
+        string_view bytes(file.data() + pos, length);
+        pos += length;
+        return bytes;
+    }
+
+    // count элементов T прямо в отображении; позиция должна быть выровнена под T
+    template <typename T>
+    const T* view(size_t count) {
+        if (count > (file.size() - pos) / sizeof(T)) {
+            throw runtime_error("Файл обрезан на смещении " + to_string(pos));
+        }
+        const T* items = reinterpret_cast<const T*>(file.data() + pos);
+        pos += count * sizeof(T);
+        return items;
+    }
+
+    void align(size_t alignment) {
+        size_t aligned = (pos + alignment - 1) / alignment * alignment;
+        need(aligned - pos);
+        pos = aligned;
+    }
+
+    size_t position() const {
+        return pos;
+    }
+
+private:
+    void need(size_t bytes) const {
+        if (file.size() - pos < bytes) {
+            throw runtime_error("Файл обрезан на смещении " + to_string(pos));
+        }
+    }
+
+    const MappedFile& file;
+    size_t pos;
+};
+
+// Последовательная запись файла с подсчетом смещения для выравнивания
+class FileWriter {
+public:
+    explicit FileWriter(const string& path) : path(path), out(path, ios::binary) {
+        if (!out) {
+            throw runtime_error("Не удалось создать " + path);
+        }
+    }
+
+    void write(const void* bytes, size_t size) {
+        out.write(static_cast<const char*>(bytes), static_cast<streamsize>(size));
+        written += size;
+    }
+
+    template <typename T>
+    void put(const T& value) {
+        write(&value, sizeof(T));
+    }
+
+    // Нули до границы alignment байт (не больше 64)
+    void align(size_t alignment) {
+        static const char zeros[64] = {};
+        write(zeros, (alignment - written % alignment) % alignment);
+    }
+
+    void finish() {
+        out.flush();
+        if (!out) {
+            throw runtime_error("Ошибка записи " + path);
+        }
+    }
+
+private:
+    string path;
+    ofstream out;
+    size_t written = 0;
+};
+
+// Словари в файле: фамилии, имена, отчества, должности, отделы; в каждом uint32_t count,
+// затем count раз uint32_t длина и байты строки
+void writeDictionaries(FileWriter& out, const EmployeeDictionaries& dicts) {
+    auto putDictionary = [&](const auto& dict) {
+        out.put(static_cast<uint32_t>(dict.size()));
+        for (size_t k = 0; k < dict.size(); ++k) {
+            const string& value = dict.at(k);
+            out.put(static_cast<uint32_t>(value.size()));
+            out.write(value.data(), value.size());
+        }
+    };
+    putDictionary(dicts.surnameDict);
+    putDictionary(dicts.nameDict);
+    putDictionary(dicts.patronymicDict);
+    putDictionary(dicts.positionDict);
+    putDictionary(dicts.departmentDict);
+}
+
+void readDictionaries(FileReader& in, EmployeeDictionaries& dicts) {
+    auto readDictionary = [&](auto& dict) {
+        uint32_t count = in.read<uint32_t>();
+        for (uint32_t k = 0; k < count; ++k) {
+            dict.intern(in.readBytes(in.read<uint32_t>()));
+        }
+    };
+    readDictionary(dicts.surnameDict);
+    readDictionary(dicts.nameDict);
+    readDictionary(dicts.patronymicDict);
+    readDictionary(dicts.positionDict);
+    readDictionary(dicts.departmentDict);
+}
+
+// Двоичный файл строк:
+//   char magic[8] = "EMPROWS1"; uint64_t rowCount; словари (writeDictionaries);
+//   нули до границы 16 байт, затем rowCount строк PackedRow.
+// Порядок байтов - родной для машины.
+constexpr char binaryMagic[8] = {'E', 'M', 'P', 'R', 'O', 'W', 'S', '1'};
+
+// Двоичный файл, открытый поверх отображения: словари в памяти, строки - в файле
+struct BinaryEmployeeFile : EmployeeDictionaries {
+    const PackedRow* rows = nullptr;
+    size_t rowCount = 0;
+};
+
+bool isBinaryEmployeeFile(const MappedFile& file) {
+    return file.size() >= sizeof(binaryMagic) && memcmp(file.data(), binaryMagic, sizeof(binaryMagic)) == 0;
+}
+
+// Чтение заголовка и словарей с проверкой границ
+void openBinaryEmployeeFile(const MappedFile& file, BinaryEmployeeFile& out) {
+    FileReader in(file, sizeof(binaryMagic));
+    uint64_t rowCount = in.read<uint64_t>();
+    readDictionaries(in, out);
+    in.align(16);
+    out.rows = in.view<PackedRow>(rowCount);
+    out.rowCount = rowCount;
+}
+// Запись таблицы в CSV; зарплата с 17 значащими цифрами, чтобы чтение вернуло то же число
+void writeCsvFile(const EmployeeTable& employees, const string& path) {
+    ofstream out(path, ios::binary);
+    if (!out) {
+        throw runtime_error("Не удалось создать " + path);
+    }
+    string buffer;
+    buffer += csvHeader;
+    buffer += '\n';
+    for (size_t i = 0; i < employees.size(); ++i) {
+        char salary[32];
+        snprintf(salary, sizeof(salary), "%.17g", employees.salary[i]);
+        buffer += employees.surnameDict.at(employees.surname[i]);
+        buffer += ' ';
+        buffer += employees.nameDict.at(employees.name[i]);
+        buffer += ' ';
+        buffer += employees.patronymicDict.at(employees.patronymic[i]);
+        buffer += ',';
+        buffer += employees.positionDict.at(employees.position[i]);
+        buffer += ',';
+        buffer += employees.departmentDict.at(employees.department[i]);
+        buffer += ',';
+        buffer += salary;
+        buffer += '\n';
+        if (buffer.size() >= (1 << 20)) {
+            out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    if (!out) {
+        throw runtime_error("Ошибка записи " + path);
+    }
+}
+
+void writeBinaryFile(const EmployeeTable& employees, const string& path) {
+    FileWriter out(path);
+    out.write(binaryMagic, sizeof(binaryMagic));
+    out.put(static_cast<uint64_t>(employees.size()));
+    writeDictionaries(out, employees);
+    out.align(16);
+
+    vector<PackedRow> batch;
+    batch.reserve(65536);
+    for (size_t i = 0; i < employees.size(); ++i) {
+        batch.push_back({employees.salary[i], employees.surname[i], employees.name[i], employees.patronymic[i],
+                         employees.position[i], employees.department[i]});
+        if (batch.size() == batch.capacity() || i + 1 == employees.size()) {
+            out.write(batch.data(), batch.size() * sizeof(PackedRow));
+            batch.clear();
+        }
+    }
+    out.finish();
+}
+
+// Запись журнала о строке CSV - фрагменте отображенного файла
+struct CsvLine {
+    const char* begin;
+    size_t length;
+};
+
+void formatCsvLine(string& out, const CsvLine& line) {
+    CsvRow row;
+    parseCsvRow(line.begin, line.begin + line.length, row); // Строка уже проверена при отборе
+    out += "ФИО: ";
+    out += row.fio;
+    appendEmployeeTail(out, row.position, row.department, row.salary);
+}
+
+// Запись журнала о строке двоичного файла
+struct BinaryRowEntry {
+    const BinaryEmployeeFile* file;
+    const PackedRow* row;
+};
+
+void formatBinaryRow(string& out, const BinaryRowEntry& entry) {
+    const BinaryEmployeeFile& f = *entry.file;
+    const PackedRow& row = *entry.row;
+    out += "ФИО: ";
+    out += f.surnameDict.at(row.surname);
+    out += ' ';
+    out += f.nameDict.at(row.name);
+    out += ' ';
+    out += f.patronymicDict.at(row.patronymic);
+    appendEmployeeTail(out, f.positionDict.at(row.position), f.departmentDict.at(row.department), row.salary);
+}
+
+// Итог потоковой обработки файла
+struct StreamSummary {
+    size_t rows = 0;                 // Строк в файле
+    size_t selected = 0;             // Строк выше средней по отделу
+    chrono::duration<double> pass1{}; // Первый проход: средние по отделам
+    chrono::duration<double> pass2{}; // Второй проход: отбор и вывод
+    size_t blocks = 0;               // Блоков столбцового файла
+    size_t blocksSkipped = 0;        // Блоков, отброшенных по карте зон
+    size_t blocksWhole = 0;          // Блоков, выведенных целиком без чтения зарплат
+};
+
+// Второй проход окнами по numThreads * 4 блоков: потоки отбирают строки своих блоков,
+// затем вызывающий поток выводит их в порядке блоков. Памяти нужно на одно окно.
+// Исключение из select прерывает проход до вывода строк своего окна.
+template <typename Select, typename Emit>
+size_t selectInWindows(int numThreads, size_t numChunks, Select&& select, Emit&& emit) {
+    size_t window = static_cast<size_t>(numThreads) * 4;
+    vector<vector<size_t>> selected(window);
+    size_t total = 0;
+    try {
+        for (size_t first = 0; first < numChunks; first += window) {
+            size_t count = min(window, numChunks - first);
+            parallelForDynamic(numThreads, count, [&](int, size_t k) {
+                selected[k].clear();
+                select(first + k, selected[k]);
+            });
+            for (size_t k = 0; k < count; ++k) {
+                for (size_t item : selected[k]) {
+                    emit(item);
+                }
+                total += selected[k].size();
+            }
+        }
+    } catch (...) {
+        AsyncLog::instance().flush(); // Уже выведенные записи ссылаются на отображение
+        throw;
+    }
+    AsyncLog::instance().flush(); // Записи ссылаются на отображение файла
+    return total;
+}
+
+// Частичный агрегат потока для CSV: отделы встречаются по мере чтения, поэтому у
+// каждого потока свой словарь, а коды сводятся к общим при слиянии
+struct alignas(64) CsvPartial {
+    StringDictionary<uint32_t> departments;
+    DeptTotals totals;
+    size_t rows = 0;
+};
+
+// Потоковая обработка CSV: объекты сотрудников не создаются, строки разбираются прямо в отображении
+StreamSummary processCsvFile(const MappedFile& file, int numThreads) {
+    StreamSummary summary;
+    const char* data = file.data();
+    size_t begin = 0;
+    if (file.size() >= csvHeader.size() && string_view(data, csvHeader.size()) == csvHeader) {
+        const char* newline = static_cast<const char*>(memchr(data, '\n', file.size()));
+        begin = newline ? static_cast<size_t>(newline - data) + 1 : file.size();
+    }
+    vector<size_t> bounds = splitCsvChunks(data, file.size(), begin, ingestChunkBytes);
+    size_t numChunks = bounds.size() - 1;
+
+    // Первый проход: суммы и количества по отделам
+    auto start = chrono::high_resolution_clock::now();
+    vector<CsvPartial> partials(numThreads);
+    parallelForDynamic(numThreads, numChunks, [&](int t, size_t chunk) {
+        CsvPartial& mine = partials[t];
+        forEachCsvRow(data, bounds[chunk], bounds[chunk + 1], [&mine](const CsvRow& row, const char*, size_t) {
+            uint32_t code = mine.departments.intern(row.department);
+            if (code == mine.totals.totalSalary.size()) {
+                mine.totals.totalSalary.push_back(0);
+                mine.totals.count.push_back(0);
+            }
+            mine.totals.totalSalary[code] += row.salary;
+            mine.totals.count[code]++;
+            mine.rows++;
+        });
+    });
+    StringDictionary<uint32_t> departments;
+    DeptTotals totals;
+    for (const auto& partial : partials) {
+        for (size_t local = 0; local < partial.departments.size(); ++local) {
+            uint32_t code = departments.intern(partial.departments.at(static_cast<uint32_t>(local)));
+            if (code == totals.totalSalary.size()) {
+                totals.totalSalary.push_back(0);
+                totals.count.push_back(0);
+            }
+            totals.totalSalary[code] += partial.totals.totalSalary[local];
+            totals.count[code] += partial.totals.count[local];
+        }
+        summary.rows += partial.rows;
+    }
+    DeptAverages averages = totals.averages();
+    summary.pass1 = chrono::high_resolution_clock::now() - start;
+
+    // Второй проход: строки выше средней по отделу
+    start = chrono::high_resolution_clock::now();
+    summary.selected = selectInWindows(
+        numThreads, numChunks,
+        [&](size_t chunk, vector<size_t>& selected) {
+            forEachCsvRow(data, bounds[chunk], bounds[chunk + 1], [&](const CsvRow& row, const char* line, size_t) {
+                uint32_t code;
+                if (departments.find(row.department, code) && row.salary > averages[code]) {
+                    selected.push_back(static_cast<size_t>(line - data));
+                }
+            });
+        },
+        [&](size_t offset) {
+            const char* line = data + offset;
+            const char* newline = static_cast<const char*>(memchr(line, '\n', file.size() - offset));
+            AsyncLog::instance().write(formatCsvLine, CsvLine{line, static_cast<size_t>((newline ? newline : data + file.size()) - line)});
+        });
+    summary.pass2 = chrono::high_resolution_clock::now() - start;
+    return summary;
+}
+
+// Потоковая обработка двоичного файла: строки читаются прямо из отображения
+StreamSummary processBinaryFile(const MappedFile& file, int numThreads) {
+    StreamSummary summary;
+    BinaryEmployeeFile employees;
+    openBinaryEmployeeFile(file, employees);
+    size_t chunkRows = ingestChunkBytes / sizeof(PackedRow);
+    size_t numChunks = (employees.rowCount + chunkRows - 1) / chunkRows;
+    size_t numDepartments = employees.departmentDict.size();
+    summary.rows = employees.rowCount;
+
+    // Первый проход: суммы и количества по отделам
+    auto start = chrono::high_resolution_clock::now();
+    vector<DeptPartial> partials(numThreads);
+    for (auto& partial : partials) {
+        partial.totals = DeptTotals(numDepartments);
+    }
+    parallelForDynamic(numThreads, numChunks, [&](int t, size_t chunk) {
+        DeptTotals& mine = partials[t].totals;
+        size_t end = min(employees.rowCount, (chunk + 1) * chunkRows);
+        for (size_t i = chunk * chunkRows; i < end; ++i) {
+            const PackedRow& row = employees.rows[i];
+            if (!employees.codesInRange(row.surname, row.name, row.patronymic, row.position, row.department)) {
+                throw runtime_error("Некорректный код словаря в строке " + to_string(i));
+            }
+            mine.totalSalary[row.department] += row.salary;
+            mine.count[row.department]++;
+        }
+    });
+    for (int t = 1; t < numThreads; ++t) {
+        partials[0].totals.merge(partials[t].totals);
+    }
+    DeptAverages averages = partials[0].totals.averages();
+    summary.pass1 = chrono::high_resolution_clock::now() - start;
+
+    // Второй проход: строки выше средней по отделу
+    start = chrono::high_resolution_clock::now();
+    summary.selected = selectInWindows(
+        numThreads, numChunks,
+        [&](size_t chunk, vector<size_t>& selected) {
+            size_t end = min(employees.rowCount, (chunk + 1) * chunkRows);
+            for (size_t i = chunk * chunkRows; i < end; ++i) {
+                if (employees.rows[i].salary > averages[employees.rows[i].department]) {
+                    selected.push_back(i);
+                }
+            }
+        },
+        [&](size_t row) { AsyncLog::instance().write(formatBinaryRow, BinaryRowEntry{&employees, &employees.rows[row]}); });
+    summary.pass2 = chrono::high_resolution_clock::now() - start;
+    return summary;
+}
+
+// Столбцовый файл блоками строк:
+//   char magic[8] = "EMPCOLS1"; uint64_t rowCount; uint32_t blockRows; uint32_t numBlocks;
+//   словари (writeDictionaries);
+//   с границы 64 байт - карта зон: numBlocks * numDepartments записей ZoneEntry;
+//   затем блоки подряд, блок i - строки [i * blockRows, min(rowCount, (i + 1) * blockRows)).
+// В блоке столбцы идут друг за другом, каждый с границы 64 байт: salary double[n],
+// department uint8_t[n], position uint8_t[n], surname, name, patronymic uint16_t[n].
+// Блоки, кроме последнего, одного размера, поэтому смещения вычисляются, а не хранятся.
+constexpr char columnarMagic[8] = {'E', 'M', 'P', 'C', 'O', 'L', 'S', '1'};
+
+// Строк в блоке столбцового файла
+constexpr size_t columnarBlockRows = 1 << 16;
+
+// Метаданные отдела в блоке: по ним считаются средние и отбрасываются блоки без кандидатов
+struct ZoneEntry {
+    double sum;        // Сумма зарплат отдела в блоке
+    int64_t count;     // Строк отдела в блоке
+    double minSalary;  // +inf, если отдела в блоке нет
+    double maxSalary;  // -inf, если отдела в блоке нет
+};
+
+size_t alignUp64(size_t bytes) {
+    return (bytes + 63) / 64 * 64;
+}
+
+// Размер блока из n строк вместе с выравниванием столбцов
+size_t columnarBlockBytes(size_t n) {
+    return alignUp64(n * sizeof(double)) + 2 * alignUp64(n) + 3 * alignUp64(n * sizeof(uint16_t));
+}
+
+// Столбцы одного блока прямо в отображении
+struct ColumnarBlock {
+    size_t rows;
+    const double* salary;
+    const DeptCode* department;
+    const uint8_t* position;
+    const uint16_t* surname;
+    const uint16_t* name;
+    const uint16_t* patronymic;
+};
+
+// Столбцовый файл, открытый поверх отображения
+struct ColumnarEmployeeFile : EmployeeDictionaries {
+    size_t rowCount = 0;
+    size_t blockRows = 0;
+    size_t numBlocks = 0;
+    const ZoneEntry* zones = nullptr; // numBlocks * departmentDict.size()
+    const char* blocks = nullptr;
+
+    const ZoneEntry* zone(size_t b) const {
+        return zones + b * departmentDict.size();
+    }
+
+    ColumnarBlock block(size_t b) const {
+        ColumnarBlock out;
+        out.rows = min(blockRows, rowCount - b * blockRows);
+        const char* p = blocks + b * columnarBlockBytes(blockRows);
+        out.salary = reinterpret_cast<const double*>(p);
+        p += alignUp64(out.rows * sizeof(double));
+        out.department = reinterpret_cast<const DeptCode*>(p);
+        p += alignUp64(out.rows);
+        out.position = reinterpret_cast<const uint8_t*>(p);
+        p += alignUp64(out.rows);
+        out.surname = reinterpret_cast<const uint16_t*>(p);
+        p += alignUp64(out.rows * sizeof(uint16_t));
+        out.name = reinterpret_cast<const uint16_t*>(p);
+        p += alignUp64(out.rows * sizeof(uint16_t));
+        out.patronymic = reinterpret_cast<const uint16_t*>(p);
+        return out;
+    }
+
+    // Проверка кодов блока перед выводом его строк: максимумы столбцов против словарей
+    void checkCodes(const ColumnarBlock& block, size_t b) const {
+        DeptCode department = 0;
+        uint8_t position = 0;
+        uint16_t surname = 0, name = 0, patronymic = 0;
+        for (size_t r = 0; r < block.rows; ++r) {
+            department = max(department, block.department[r]);
+            position = max(position, block.position[r]);
+            surname = max(surname, block.surname[r]);
+            name = max(name, block.name[r]);
+            patronymic = max(patronymic, block.patronymic[r]);
+        }
+        if (block.rows > 0 && !codesInRange(surname, name, patronymic, position, department)) {
+            throw runtime_error("Некорректный код словаря в блоке " + to_string(b));
+        }
+    }
+};
+
+bool isColumnarEmployeeFile(const MappedFile& file) {
+    return file.size() >= sizeof(columnarMagic) && memcmp(file.data(), columnarMagic, sizeof(columnarMagic)) == 0;
+}
+
+void openColumnarEmployeeFile(const MappedFile& file, ColumnarEmployeeFile& out) {
+    FileReader in(file, sizeof(columnarMagic));
+    out.rowCount = in.read<uint64_t>();
+    out.blockRows = in.read<uint32_t>();
+    out.numBlocks = in.read<uint32_t>();
+    if (out.blockRows == 0 || out.blockRows % 64 != 0 ||
+        out.numBlocks != (out.rowCount + out.blockRows - 1) / out.blockRows) {
+        throw runtime_error("Некорректный заголовок столбцового файла");
+    }
+    readDictionaries(in, out);
+    in.align(64);
+    out.zones = in.view<ZoneEntry>(out.numBlocks * out.departmentDict.size());
+    // Карта зон заменяет первый проход, поэтому количества в ней должны сходиться с блоками
+    for (size_t b = 0; b < out.numBlocks; ++b) {
+        int64_t rows = 0;
+        for (size_t d = 0; d < out.departmentDict.size(); ++d) {
+            int64_t count = out.zone(b)[d].count;
+            if (count < 0 || count > static_cast<int64_t>(out.blockRows)) {
+                throw runtime_error("Некорректная карта зон в блоке " + to_string(b));
+            }
+            rows += count;
+        }
+        if (rows != static_cast<int64_t>(min(out.blockRows, out.rowCount - b * out.blockRows))) {
+            throw runtime_error("Некорректная карта зон в блоке " + to_string(b));
+        }
+    }
+    in.align(64);
+    size_t dataBytes = out.numBlocks == 0 ? 0
+                                          : (out.numBlocks - 1) * columnarBlockBytes(out.blockRows) +
+                                                columnarBlockBytes(out.rowCount - (out.numBlocks - 1) * out.blockRows);
+    out.blocks = in.view<char>(dataBytes);
+}
+
+// Порядок строк, сгруппированный по отделу и зарплате: блоки получают узкие зоны,
+// и запрос «выше средней» читает только блоки на границе средней
+vector<size_t> clusteredOrder(const EmployeeTable& employees) {
+    vector<size_t> order(employees.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (employees.department[a] != employees.department[b]) {
+            return employees.department[a] < employees.department[b];
+        }
+        return employees.salary[a] < employees.salary[b];
+    });
+    return order;
+}
+
+// Запись таблицы в столбцовый файл; строки идут в порядке order
+void writeColumnarFile(const EmployeeTable& employees, const vector<size_t>& order, const string& path) {
+    size_t numDepartments = employees.departmentDict.size();
+    size_t blockRows = columnarBlockRows;
+    size_t numBlocks = (order.size() + blockRows - 1) / blockRows;
+
+    // Карта зон считается до записи, потому что лежит перед блоками
+    vector<ZoneEntry> zones(numBlocks * numDepartments, ZoneEntry{0, 0, INFINITY, -INFINITY});
+    for (size_t k = 0; k < order.size(); ++k) {
+        size_t row = order[k];
+        ZoneEntry& z = zones[k / blockRows * numDepartments + employees.department[row]];
+        z.sum += employees.salary[row];
+        z.count++;
+        z.minSalary = min(z.minSalary, employees.salary[row]);
+        z.maxSalary = max(z.maxSalary, employees.salary[row]);
+    }
+
+    FileWriter out(path);
+    out.write(columnarMagic, sizeof(columnarMagic));
+    out.put(static_cast<uint64_t>(order.size()));
+    out.put(static_cast<uint32_t>(blockRows));
+    out.put(static_cast<uint32_t>(numBlocks));
+    writeDictionaries(out, employees);
+    out.align(64);
+    out.write(zones.data(), zones.size() * sizeof(ZoneEntry));
+    out.align(64);
+
+    auto putColumn = [&](const auto& column, size_t begin, size_t end) {
+        using Value = decay_t<decltype(column[0])>;
+        vector<Value> values;
+        values.reserve(end - begin);
+        for (size_t k = begin; k < end; ++k) {
+            values.push_back(column[order[k]]);
+        }
+        out.write(values.data(), values.size() * sizeof(Value));
+        out.align(64);
+    };
+    for (size_t b = 0; b < numBlocks; ++b) {
+        size_t begin = b * blockRows;
+        size_t end = min(order.size(), begin + blockRows);
+        putColumn(employees.salary, begin, end);
+        putColumn(employees.department, begin, end);
+        putColumn(employees.position, begin, end);
+        putColumn(employees.surname, begin, end);
+        putColumn(employees.name, begin, end);
+        putColumn(employees.patronymic, begin, end);
+    }
+    out.finish();
+}
+
+// Запись журнала о строке столбцового файла
+struct ColumnarRowEntry {
+    const ColumnarEmployeeFile* file;
+    size_t row;
+};
+
+void formatColumnarRow(string& out, const ColumnarRowEntry& entry) {
+    const ColumnarEmployeeFile& f = *entry.file;
+    ColumnarBlock block = f.block(entry.row / f.blockRows);
+    size_t r = entry.row % f.blockRows;
+    out += "ФИО: ";
+    out += f.surnameDict.at(block.surname[r]);
+    out += ' ';
+    out += f.nameDict.at(block.name[r]);
+    out += ' ';
+    out += f.patronymicDict.at(block.patronymic[r]);
+    appendEmployeeTail(out, f.positionDict.at(block.position[r]), f.departmentDict.at(block.department[r]),
+                       block.salary[r]);
+}
+
+// Запрос по столбцовому файлу: средние - по карте зон без чтения строк; блок, где ни
+// один отдел не превышает свою среднюю, пропускается, а блок, где все строки выше
+// средних, выводится без чтения столбца зарплат
+StreamSummary processColumnarFile(const MappedFile& file, int numThreads) {
+    StreamSummary summary;
+    ColumnarEmployeeFile employees;
+    openColumnarEmployeeFile(file, employees);
+    size_t numDepartments = employees.departmentDict.size();
+    summary.rows = employees.rowCount;
+    summary.blocks = employees.numBlocks;
+
+    // Первый проход - только по метаданным
+    auto start = chrono::high_resolution_clock::now();
+    DeptTotals totals(numDepartments);
+    for (size_t b = 0; b < employees.numBlocks; ++b) {
+        const ZoneEntry* zone = employees.zone(b);
+        for (size_t d = 0; d < numDepartments; ++d) {
+            totals.totalSalary[d] += zone[d].sum;
+            totals.count[d] += zone[d].count;
+        }
+    }
+    DeptAverages averages = totals.averages();
+    // Коды блоков проверяются перед отбором (checkCodes); NaN для всех 256 кодов
+    // дополнительно страхует векторный filterAbove
+    averages.resize(size_t(numeric_limits<DeptCode>::max()) + 1, NAN);
+
+    vector<size_t> candidates;  // Блоки, которые нужно прочитать
+    vector<char> wholeBlock;    // Все строки блока выше средних своих отделов
+    for (size_t b = 0; b < employees.numBlocks; ++b) {
+        const ZoneEntry* zone = employees.zone(b);
+        bool any = false;
+        bool all = true;
+        for (size_t d = 0; d < numDepartments; ++d) {
+            if (zone[d].count > 0) {
+                any = any || zone[d].maxSalary > averages[d];
+                all = all && zone[d].minSalary > averages[d];
+            }
+        }
+        if (any) {
+            candidates.push_back(b);
+            wholeBlock.push_back(all);
+            summary.blocksWhole += all;
+        }
+    }
+    summary.blocksSkipped = employees.numBlocks - candidates.size();
+    summary.pass1 = chrono::high_resolution_clock::now() - start;
+
+    // Второй проход: только блоки-кандидаты
+    start = chrono::high_resolution_clock::now();
+    summary.selected = selectInWindows(
+        numThreads, candidates.size(),
+        [&](size_t k, vector<size_t>& selected) {
+            size_t b = candidates[k];
+            ColumnarBlock block = employees.block(b);
+            employees.checkCodes(block, b);
+            size_t first = b * employees.blockRows;
+            if (wholeBlock[k]) {
+                for (size_t r = 0; r < block.rows; ++r) {
+                    selected.push_back(first + r);
+                }
+                return;
+            }
+            vector<uint64_t> bits((block.rows + 63) / 64);
+            filterAbove(block.salary, block.department, block.rows, averages.data(), bits.data());
+            for (size_t w = 0; w < bits.size(); ++w) {
+                for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                    selected.push_back(first + w * 64 + countr_zero(word));
+                }
+            }
+        },
+        [&](size_t row) { AsyncLog::instance().write(formatColumnarRow, ColumnarRowEntry{&employees, row}); });
+    summary.pass2 = chrono::high_resolution_clock::now() - start;
+    return summary;
+}
+
+// Раскладка «по записям» для сравнения со столбцовой в замерах масштабирования
+vector<PackedRow> toPackedRows(const EmployeeTable& employees) {
+    vector<PackedRow> rows(employees.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = {employees.salary[i], employees.surname[i], employees.name[i], employees.patronymic[i],
+                   employees.position[i], employees.department[i]};
+    }
+    return rows;
+}
+
+void accumulatePackedRows(const PackedRow* rows, size_t begin, size_t end, DeptTotals& totals) {
+    for (size_t i = begin; i < end; ++i) {
+        totals.totalSalary[rows[i].department] += rows[i].salary;
+        totals.count[rows[i].department]++;
+    }
+}
+
+// Средние по строкам PackedRow: агрегаты потоков, затем слияние в вызывающем потоке
+DeptAverages calculateAverageSalaryPackedParallel(const vector<PackedRow>& rows, size_t numDepartments,
+                                                  int numThreads, size_t chunkRows = 1 << 16) {
+    vector<DeptPartial> partials(numThreads);
+    parallelForDynamic(numThreads, (rows.size() + chunkRows - 1) / chunkRows, [&](int t, size_t chunk) {
+        DeptTotals& mine = partials[t].totals;
+        if (mine.totalSalary.empty()) {
+            mine = DeptTotals(numDepartments); // Выделяет сам поток
+        }
+        accumulatePackedRows(rows.data(), chunk * chunkRows, min(rows.size(), (chunk + 1) * chunkRows), mine);
+    });
+    DeptTotals totals(numDepartments);
+    for (const auto& partial : partials) {
+        if (!partial.totals.totalSalary.empty()) {
+            totals.merge(partial.totals);
+        }
+    }
+    return totals.averages();
+}
+
+// Лучшее время из повторов; повторы идут, пока не наберется 0.2 сек (не меньше 3, не больше 1000)
+template <typename Run>
+double bestTime(Run&& run, DeptAverages& result) {
+    double best = INFINITY;
+    double total = 0;
+    for (int rep = 0; rep < 1000 && (rep < 3 || total < 0.2); ++rep) {
+        auto start = chrono::high_resolution_clock::now();
+        result = run();
+        double elapsed = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+        best = min(best, elapsed);
+        total += elapsed;
+    }
+    return best;
+}
+
+// Замер масштабирования: размер 10, 100, ... до maxRows, потоки из списка, обе раскладки,
+// обычное и воспроизводимое суммирование. Каждый результат сверяется с эталонным
+// calculateAverageSalary, а воспроизводимый - еще и побитно между числами потоков.
+// Вывод - CSV в stdout.
+void runScalingBenchmark(size_t maxRows, const vector<int>& threadCounts, uint64_t seed) {
+    int maxThreads = *max_element(threadCounts.begin(), threadCounts.end());
+    cout << "layout,mode,rows,threads,seconds,rows_per_sec,gb_per_sec" << endl;
+    for (size_t rows = 10; rows <= maxRows; rows *= 10) {
+        EmployeeTable table = generateEmployees(rows, seed, maxThreads);
+        vector<PackedRow> packed = toPackedRows(table);
+        size_t numDepartments = table.departmentDict.size();
+        DeptAverages reference = calculateAverageSalary(table);
+
+        struct Variant {
+            const char* layout;
+            const char* mode;
+            size_t bytesPerRow;
+            function<DeptAverages(int)> run;
+        };
+        const Variant variants[] = {
+            {"columns", "fast", sizeof(double) + sizeof(DeptCode),
+             [&](int t) { return calculateAverageSalaryParallel(table, t); }},
+            {"columns", "reproducible", sizeof(double) + sizeof(DeptCode),
+             [&](int t) { return calculateAverageSalaryReproducible(table, t); }},
+            {"rows", "fast", sizeof(PackedRow),
+             [&](int t) { return calculateAverageSalaryPackedParallel(packed, numDepartments, t); }},
+            {"rows", "reproducible", sizeof(PackedRow),
+             [&](int t) {
+                 return reproducibleAverages(rows, numDepartments, t, 1 << 16,
+                                             [&](size_t begin, size_t end, DeptTotals& totals) {
+                                                 accumulatePackedRows(packed.data(), begin, end, totals);
+                                             });
+             }},
+        };
+        for (const auto& variant : variants) {
+            DeptAverages first;
+            for (int t : threadCounts) {
+                DeptAverages result;
+                double seconds = bestTime([&] { return variant.run(t); }, result);
+                if (maxRelativeDifference(reference, result) > 1e-9) {
+                    throw runtime_error(string("Результат ") + variant.layout + "/" + variant.mode +
+                                        " расходится с эталоном при потоках: " + to_string(t));
+                }
+                bool reproducible = string(variant.mode) == "reproducible";
+                if (reproducible && first.empty()) {
+                    first = result;
+                } else if (reproducible && memcmp(first.data(), result.data(), first.size() * sizeof(double)) != 0) {
+                    throw runtime_error(string("Воспроизводимая сумма ") + variant.layout +
+                                        " зависит от числа потоков: " + to_string(t));
+                }
+                double rowsPerSec = rows / seconds;
+                cout << variant.layout << ',' << variant.mode << ',' << rows << ',' << t << ',' << seconds << ','
+                     << rowsPerSec << ',' << rowsPerSec * variant.bytesPerRow / 1e9 << endl;
+            }
+        }
+    }
+}
+
+// Список чисел потоков через запятую: "1,2,4,8"
+bool parseThreadList(const string& text, vector<int>& out) {
+    vector<int> values;
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t comma = text.find(',', pos);
+        int value = atoi(text.substr(pos, comma - pos).c_str());
+        if (value <= 0) {
+            return false;
+        }
+        values.push_back(value);
+        if (comma == string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+    out = values;
+    return !out.empty();
+}
+
+int main(int argc, char** argv) {
     int numEmployees = 10; // Количество сотрудников
-    vector<Employee> employees = generateEmployees(numEmployees);
+    int numThreads = max(1u, thread::hardware_concurrency()); // Количество потоков
+    string inputPath, csvPath, binaryPath, columnarPath;
+    bool cluster = false;
+    long long onlineChanges = -1; // --online N: поток из N изменений вместо разовых расчетов
+    uint32_t sketchK = 0;          // --quantiles K: квантили скетчами KLL с параметром K
+    bool exactQuantiles = false;   // --quantiles-exact: сверка скетчей с точными квантилями
+    bool reproducible = false;     // --reproducible: средние не зависят от числа потоков побитно
+    size_t benchMaxRows = 0;       // --bench N: замер масштабирования до N строк
+    vector<int> benchThreads;      // --bench-threads LIST
+    uint64_t seed = random_device{}(); // Зерно генератора; одно зерно - один набор при любом числе потоков
+
+    // Параметры: --log async|sync|off, --rows N, --threads N, --kernels auto|scalar|avx2|avx512,
+    // --input FILE (CSV, двоичный или столбцовый файл вместо генерации), --write-csv FILE,
+    // --write-bin FILE, --write-cols FILE, --cluster (столбцовый файл по отделу и зарплате), --seed N,
+    // --online N (N вставок, изменений и удалений с запросом после каждого),
+    // --quantiles K (медиана, p90, p99 по отделам), --quantiles-exact, --reproducible,
+    // --bench N (размеры 10..N), --bench-threads LIST (по умолчанию степени двойки до --threads)
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        LogMode mode;
+        if (arg == "--log" && i + 1 < argc && parseLogMode(argv[i + 1], mode)) {
+            AsyncLog::instance().setMode(mode);
+            ++i;
+        } else if (arg == "--kernels" && i + 1 < argc && parseKernelSet(argv[i + 1], activeKernels)) {
+            ++i;
+        } else if ((arg == "--rows" || arg == "--threads") && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            (arg == "--rows" ? numEmployees : numThreads) = atoi(argv[++i]);
+        } else if ((arg == "--input" || arg == "--write-csv" || arg == "--write-bin" || arg == "--write-cols") &&
+                   i + 1 < argc) {
+            (arg == "--input"       ? inputPath
+             : arg == "--write-csv" ? csvPath
+             : arg == "--write-bin" ? binaryPath
+                                    : columnarPath) = argv[++i];
+        } else if (arg == "--cluster") {
+            cluster = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--online" && i + 1 < argc && atoll(argv[i + 1]) >= 0) {
+            onlineChanges = atoll(argv[++i]);
+        } else if (arg == "--quantiles" && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            sketchK = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (arg == "--quantiles-exact") {
+            exactQuantiles = true;
+        } else if (arg == "--reproducible") {
+            reproducible = true;
+        } else if (arg == "--bench" && i + 1 < argc && atoll(argv[i + 1]) >= 10) {
+            benchMaxRows = static_cast<size_t>(atoll(argv[++i]));
+        } else if (arg == "--bench-threads" && i + 1 < argc && parseThreadList(argv[i + 1], benchThreads)) {
+            ++i;
+        } else {
+            cerr << "Использование: " << argv[0] << " [--log async|sync|off] [--rows N] [--threads N]"
+                 << " [--kernels auto|scalar|avx2|avx512] [--input FILE] [--write-csv FILE] [--write-bin FILE]"
+                 << " [--write-cols FILE] [--cluster] [--seed N] [--online N]"
+                 << " [--quantiles K] [--quantiles-exact] [--reproducible] [--bench N] [--bench-threads LIST]"
+                 << endl;
+            return 1;
+        }
+    }
+
+    // Файл обрабатывается потоком в два прохода, таблица в памяти не строится
+    if (!inputPath.empty()) {
+        try {
+            MappedFile file(inputPath);
+            StreamSummary summary;
+            if (isColumnarEmployeeFile(file)) {
+                cout << "Результаты обработки файла " << inputPath << " (столбцовый):" << endl;
+                summary = processColumnarFile(file, numThreads);
+            } else if (isBinaryEmployeeFile(file)) {
+                cout << "Результаты обработки файла " << inputPath << " (двоичный):" << endl;
+                summary = processBinaryFile(file, numThreads);
+            } else {
+                cout << "Результаты обработки файла " << inputPath << " (CSV):" << endl;
+                summary = processCsvFile(file, numThreads);
+            }
+            cout << "Первый проход (средние по отделам): " << summary.pass1.count() << " сек" << endl;
+            cout << "Второй проход (отбор и вывод): " << summary.pass2.count() << " сек" << endl;
+            cout << "Строк: " << summary.rows << ", выше средней: " << summary.selected << endl;
+            if (summary.blocks > 0) {
+                cout << "Блоков: " << summary.blocks << ", пропущено по карте зон: " << summary.blocksSkipped
+                     << ", выведено целиком: " << summary.blocksWhole << endl;
+            }
+        } catch (const exception& e) {
+            AsyncLog::instance().flush();
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (benchMaxRows > 0) {
+        if (benchThreads.empty()) {
+            for (int t = 1; t < numThreads; t *= 2) {
+                benchThreads.push_back(t);
+            }
+            benchThreads.push_back(numThreads);
+        }
+        try {
+            runScalingBenchmark(benchMaxRows, benchThreads, seed);
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
 
-    // Время без многопоточности
     auto start = chrono::high_resolution_clock::now();
+    EmployeeTable employees = generateEmployees(numEmployees, seed, numThreads);
+    cout << "Время генерации: " << chrono::duration<double>(chrono::high_resolution_clock::now() - start).count()
+         << " сек (зерно " << seed << ")" << endl;
+
+    try {
+        if (!csvPath.empty()) {
+            writeCsvFile(employees, csvPath);
+        }
+        if (!binaryPath.empty()) {
+            writeBinaryFile(employees, binaryPath);
+        }
+        if (!columnarPath.empty()) {
+            vector<size_t> order;
+            if (cluster) {
+                order = clusteredOrder(employees);
+            } else {
+                order.resize(employees.size());
+                for (size_t i = 0; i < order.size(); ++i) {
+                    order[i] = i;
+                }
+            }
+            writeColumnarFile(employees, order, columnarPath);
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (onlineChanges >= 0) {
+        try {
+            start = chrono::high_resolution_clock::now();
+            OnlineSalaryStats stats(std::move(employees));
+            cout << "Построение индексов: "
+                 << chrono::duration<double>(chrono::high_resolution_clock::now() - start).count() << " сек" << endl;
+            runOnlineWorkload(stats, static_cast<size_t>(onlineChanges), seed);
+            cout << "Сотрудники выше средней по отделу:" << endl;
+            stats.forEachAboveAverage(
+                [&](uint32_t row) { AsyncLog::instance().write(formatEmployeeRow, EmployeeRow{&stats.rows(), row}); });
+            AsyncLog::instance().flush();
+        } catch (const exception& e) {
+            AsyncLog::instance().flush();
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Время без многопоточности
+    start = chrono::high_resolution_clock::now();
     auto averageSalarySingleThread = calculateAverageSalary(employees);
     auto end = chrono::high_resolution_clock::now();
     chrono::duration<double> durationSingleThread = end - start;
@@ -103,34 +2225,75 @@ int main() {
 
     // Время с многопоточностью
     start = chrono::high_resolution_clock::now();
-    map<string, atomic<double>> totalSalary; // Сумма зарплат по отделам (многопоточная версия)
-    map<string, atomic<int>> count;          // Количество сотрудников по отделам (многопоточная версия)
-
-    int numThreads = thread::hardware_concurrency(); // Количество доступных потоков
-    vector<thread> threads;
-    int chunkSize = employees.size() / numThreads;
+    DeptAverages averageSalaryMultiThread = reproducible ? calculateAverageSalaryReproducible(employees, numThreads)
+                                                         : calculateAverageSalaryParallel(employees, numThreads);
+    end = chrono::high_resolution_clock::now();
+    chrono::duration<double> durationMultiThread = end - start;
+    cout << "Время обработки с многопоточностью: " << durationMultiThread.count() << " сек" << endl;
 
-    // Создаем потоки для обработки сотрудников
-    for (int i = 0; i < numThreads; ++i) {
-        int start = i * chunkSize;
-        int end = (i == numThreads - 1) ? employees.size() : start + chunkSize;
-        threads.emplace_back(calculateAverageSalaryThread, ref(employees), ref(totalSalary), ref(count), start, end);
+    // Воспроизводимая сумма обязана совпасть побитно с той же суммой в одном потоке
+    if (reproducible) {
+        DeptAverages oneThread = calculateAverageSalaryReproducible(employees, 1);
+        if (memcmp(oneThread.data(), averageSalaryMultiThread.data(), oneThread.size() * sizeof(double)) != 0) {
+            cerr << "Воспроизводимые средние зависят от числа потоков" << endl;
+            return 1;
+        }
     }
 
-    // Дожидаемся завершения всех потоков
-    for (auto& t : threads) {
-        t.join();
+    // Порядок сложения в потоках другой, поэтому средние сверяются с допуском
+    double difference = maxRelativeDifference(averageSalarySingleThread, averageSalaryMultiThread);
+    if (difference > 1e-9) {
+        cerr << "Средние расходятся: относительная разница " << difference << endl;
+        return 1;
     }
 
-    map<string, double> averageSalaryMultiThread; // Средняя зарплата по отделам (многопоточная версия)
-    // Рассчитываем среднюю зарплату для каждого отдела
-    for (const auto& pair : totalSalary) {
-        averageSalaryMultiThread[pair.first] = pair.second / count[pair.first];
+    // Время отбора строк выше средней (без вывода)
+    start = chrono::high_resolution_clock::now();
+    vector<uint64_t> selected = selectAboveAverage(employees, averageSalarySingleThread);
+    end = chrono::high_resolution_clock::now();
+    size_t selectedRows = 0;
+    for (uint64_t word : selected) {
+        selectedRows += popcount(word);
     }
+    cout << "Время отбора выше средней: " << chrono::duration<double>(end - start).count() << " сек, строк: "
+         << selectedRows << endl;
 
-    end = chrono::high_resolution_clock::now();
-    chrono::duration<double> durationMultiThread = end - start;
-    cout << "Время обработки с многопоточностью: " << durationMultiThread.count() << " сек" << endl;
+    // Квантили зарплат: скетчи в потоках, при --quantiles-exact - сверка с сортировкой
+    if (sketchK > 0 || exactQuantiles) {
+        uint32_t k = sketchK > 0 ? sketchK : 200;
+        start = chrono::high_resolution_clock::now();
+        DeptQuantiles sketched = calculateSalaryQuantilesParallel(employees, numThreads, k);
+        end = chrono::high_resolution_clock::now();
+        cout << "Время квантилей (KLL, k = " << k << ", ожидаемая ошибка ранга "
+             << KllSketch::rankErrorBound(k) * 100 << "%): " << chrono::duration<double>(end - start).count()
+             << " сек" << endl;
+        DeptQuantiles exact;
+        vector<vector<double>> sorted;
+        if (exactQuantiles) {
+            start = chrono::high_resolution_clock::now();
+            exact = calculateSalaryQuantilesExact(employees, sorted);
+            end = chrono::high_resolution_clock::now();
+            cout << "Время точных квантилей (сортировка): " << chrono::duration<double>(end - start).count()
+                 << " сек" << endl;
+        }
+        double worstRankError = 0;
+        for (size_t d = 0; d < sketched.size(); ++d) {
+            cout << employees.departmentDict.at(d) << ":";
+            for (size_t q = 0; q < reportedQuantiles.size(); ++q) {
+                cout << " p" << reportedQuantiles[q] * 100 << " = " << sketched[d][q];
+                if (exactQuantiles) {
+                    cout << " (точно " << exact[d][q] << ")";
+                    if (!sorted[d].empty()) {
+                        worstRankError = max(worstRankError, rankError(sorted[d], sketched[d][q], exact[d][q]));
+                    }
+                }
+            }
+            cout << endl;
+        }
+        if (exactQuantiles) {
+            cout << "Наибольшая ошибка ранга: " << worstRankError * 100 << "%" << endl;
+        }
+    }
 
     // Вывод результатов
     cout << "Результаты обработки без многопоточности:" << endl;
@@ -1,32 +1,52 @@
 #include <iostream>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <queue>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <semaphore>
+#include <thread>
+#include <numeric>
+#include <bit>
+#include "fast_random.h"
+#include "kernel_set.h"
+
 using namespace std;
 
-// Структура для представления одномерного массива (вектора) как связного списка
-struct Node {
-    int value;
-    Node* next;
-};
+// Выделяем выровненный по строке кэша массив из count нулей
+int* NewAlignedInts(size_t count) {
+    size_t bytes = max<size_t>(64, (count * sizeof(int) + 63) / 64 * 64);
+    int* data = static_cast<int*>(::operator new(bytes, align_val_t(64)));
+    memset(data, 0, bytes);
+    return data;
+}
+
+void DeleteAlignedInts(int* data) {
+    ::operator delete(data, align_val_t(64));
+}
 
+// Структура для представления одномерного массива (вектора): непрерывный массив,
+// выровненный по строке кэша; доступ по индексу - O(1)
 struct Vector {
-    Node* head;
-    Vector* next;
+    int* data;
     int size;
 };
 
-// Создаем новый вектор заданного размера
+// Создаем новый вектор заданного размера, заполненный нулями
 Vector* NewVector(int size) {
-    Vector* v = new Vector{nullptr, nullptr, size};
-    Node* current = new Node{0, nullptr}; // Первый узел
-    v->head = current;
+    return new Vector{NewAlignedInts(size), size};
+}
 
-    // Создаем цепочку из узлов с нулевыми значениями
-    for (int i = 1; i < size; i++) {
-        Node* newNode = new Node{0, nullptr};
-        current->next = newNode;
-        current = newNode;
-    }
-    return v;
+void DeleteVector(Vector* v) {
+    DeleteAlignedInts(v->data);
+    delete v;
 }
 
 // Получаем значение элемента вектора по индексу
@@ -35,12 +55,8 @@ int Get(Vector* v, int index, bool& ok) {
         ok = false; // Индекс вне границ
         return 0;
     }
-    Node* current = v->head;
-    for (int i = 0; i < index; i++) {
-        current = current->next;
-    }
     ok = true;
-    return current->value;
+    return v->data[index];
 }
 
 // Устанавливаем значение элемента вектора по индексу
@@ -48,45 +64,42 @@ bool Set(Vector* v, int value, int index) {
     if (index < 0 || index >= v->size) {
         return false; // Индекс вне границ
     }
-    Node* current = v->head;
-    for (int i = 0; i < index; i++) {
-        current = current->next;
-    }
-    current->value = value;
+    v->data[index] = value;
     return true;
 }
 
 // Выводим вектор на экран
 void Print(Vector* v) {
-    Node* current = v->head;
-    while (current != nullptr) {
-        cout << current->value << " ";
-        current = current->next;
+    for (int i = 0; i < v->size; i++) {
+        cout << v->data[i] << " ";
     }
     cout << endl;
 }
 
-// Структура матрицы (двумерного массива) с заданными размерами и инициализируем нулями
-// Как связный список векторов
+// Структура матрицы (двумерного массива) с заданными размерами, заполненной нулями.
+// Строки лежат подряд в одном массиве; длина строки stride округлена до 16 int
+// (64 байта), поэтому каждая строка начинается с границы строки кэша
 struct Matrix {
-    Vector* head;
+    int* data;
     int rows;
     int cols;
+    int stride;
 };
 
 // Создаем новую матрицу
 Matrix* NewMatrix(int rows, int cols) {
-    Matrix* matrix = new Matrix{nullptr, rows, cols};
-    Vector* currentVector = NewVector(cols);
-    matrix->head = currentVector;
+    int stride = (cols + 15) / 16 * 16;
+    return new Matrix{NewAlignedInts(static_cast<size_t>(rows) * stride), rows, cols, stride};
+}
 
-    // Создаем связанный список векторов для строк матрицы
-    for (int i = 1; i < rows; i++) {
-        Vector* newVector = NewVector(cols);
-        currentVector->next = newVector;
-        currentVector = newVector;
-    }
-    return matrix;
+void DeleteMatrix(Matrix* matrix) {
+    DeleteAlignedInts(matrix->data);
+    delete matrix;
+}
+
+// Строка матрицы без проверки границ - для горячих циклов
+inline int* Row(Matrix* matrix, int row) {
+    return matrix->data + static_cast<size_t>(row) * matrix->stride;
 }
 
 // Устанавливаем значение элемента матрицы
@@ -94,12 +107,8 @@ bool SetElement(Matrix* matrix, int row, int col, int value) {
     if (row >= matrix->rows || col >= matrix->cols || col < 0 || row < 0) {
         return false; // Индекс вне границ
     }
-
-    Vector* currentVector = matrix->head;
-    for (int i = 0; i < row; i++) {
-        currentVector = currentVector->next;
-    }
-    return Set(currentVector, value, col);
+    Row(matrix, row)[col] = value;
+    return true;
 }
 
 // Получаем значение элемента матрицы
@@ -108,149 +117,1068 @@ int GetElement(Matrix* matrix, int row, int col, bool& ok) {
         ok = false; // Индекс вне границ
         return 0;
     }
-
-    Vector* currentVector = matrix->head;
-    for (int i = 0; i < row; i++) {
-        currentVector = currentVector->next;
-    }
-    return Get(currentVector, col, ok);
+    ok = true;
+    return Row(matrix, row)[col];
 }
 
 // Выводим матрицу на экран
 void Print(Matrix* matrix) {
-    Vector* currentVector = matrix->head;
     for (int i = 0; i < matrix->rows; i++) {
-        Node* currentRow = currentVector->head;
+        int* row = Row(matrix, i);
         for (int j = 0; j < matrix->cols; j++) {
-            cout << currentRow->value << " ";
-            currentRow = currentRow->next;
+            cout << row[j] << " ";
         }
         cout << endl;
-        currentVector = currentVector->next;
     }
 }
 
 // Структура банка
-// Банк ресурсов
+// Банк ресурсов. need хранится явно и должен совпадать с max - alloc, поэтому после
+// NewBank max, alloc и avail меняются только через requestResources, releaseResources,
+// SetMax и SetAllocated: они же отмечают измененные ресурсы для повторной проверки
+// прежней безопасной последовательности. После прямой записи в матрицы или avail
+// (SetElement, Set, Row) нужно вызвать RecomputeNeed, иначе проверки будут работать
+// со старым need.
 struct Bank {
     Matrix* max; // матрица максимальных потребностей
     Matrix* alloc; // матрица выделенных ресурсов
+    Matrix* need; // матрица оставшихся потребностей Need = Max - Alloc
     Vector* avail; // вектор доступных ресурсов
     int numProcesses; // количество процессов
     int numResources; // количество ресурсов
+    vector<int> safeSequence; // последняя найденная безопасная последовательность
+    vector<char> changed; // ресурсы, менявшиеся после нахождения safeSequence
+    vector<int> changedResources; // те же ресурсы списком
 };
 
+// Отмечаем ресурс, количества которого изменились после последней успешной проверки
+void MarkChanged(Bank* bank, int resource) {
+    if (!bank->changed[resource]) {
+        bank->changed[resource] = 1;
+        bank->changedResources.push_back(resource);
+    }
+}
+
+// Отмечаем ресурсы с ненулевым количеством в amounts
+void MarkChanged(Bank* bank, const int* amounts) {
+    for (int j = 0; j < bank->numResources; j++) {
+        if (amounts[j] != 0) {
+            MarkChanged(bank, j);
+        }
+    }
+}
+
+// Прежняя последовательность снова верна для всех ресурсов (после успешной проверки)
+void ClearChanged(Bank* bank) {
+    for (int j : bank->changedResources) {
+        bank->changed[j] = 0;
+    }
+    bank->changedResources.clear();
+}
+
+// Пересчитываем Need = Max - Alloc целиком (после прямой записи в max, alloc или avail).
+// Что именно менялось, неизвестно, поэтому прежняя последовательность забывается.
+void RecomputeNeed(Bank* bank) {
+    bank->safeSequence.clear();
+    ClearChanged(bank);
+    for (int i = 0; i < bank->numProcesses; i++) {
+        int* max = Row(bank->max, i);
+        int* alloc = Row(bank->alloc, i);
+        int* need = Row(bank->need, i);
+        for (int j = 0; j < bank->numResources; j++) {
+            need[j] = max[j] - alloc[j];
+        }
+    }
+}
+
 // Создаем новый банк с заданными ресурсами
 Bank* NewBank(Matrix* max, Matrix* alloc, Vector* avail, int numProcesses, int numResources) {
-    return new Bank{max, alloc, avail, numProcesses, numResources};
+    Bank* bank = new Bank{max, alloc, NewMatrix(numProcesses, numResources), avail, numProcesses, numResources, {},
+                          vector<char>(numResources, 0), {}};
+    RecomputeNeed(bank);
+    return bank;
+}
+
+// Меняем максимальную потребность процесса по ресурсу, пересчитывая need
+bool SetMax(Bank* bank, int process, int resource, int value) {
+    if (!SetElement(bank->max, process, resource, value)) {
+        return false; // Индекс вне границ
+    }
+    Row(bank->need, process)[resource] = value - Row(bank->alloc, process)[resource];
+    MarkChanged(bank, resource);
+    return true;
+}
+
+// Меняем выделенное процессу количество ресурса, пересчитывая need; avail не меняется
+bool SetAllocated(Bank* bank, int process, int resource, int value) {
+    if (!SetElement(bank->alloc, process, resource, value)) {
+        return false; // Индекс вне границ
+    }
+    Row(bank->need, process)[resource] = Row(bank->max, process)[resource] - value;
+    MarkChanged(bank, resource);
+    return true;
 }
 
 // Обрабатываем запрос ресурсов от процесса
 bool requestResources(Bank* bank, int process, Vector* request) {
-    // Проверяем, не превышает ли запрос максимальные потребности процесса и достаточно ли доступных ресурсов
+    int* req = request->data; // запрошенные ресурсы
+    int* need = Row(bank->need, process); // оставшиеся потребности
+    int* alloc = Row(bank->alloc, process); // выделенные ресурсы
+    int* avail = bank->avail->data; // доступные ресурсы
+    // Проверяем, не превышает ли запрос максимальные потребности процесса
     for (int i = 0; i < bank->numResources; i++) {
-        bool ok;
-        int req = Get(request, i, ok); // запрошенные ресурсы
-        int alloc = GetElement(bank->alloc, process, i, ok); // выделенные ресурсы
-        int max = GetElement(bank->max, process, i, ok); // максимальные потребности
-        if (req + alloc > max) {
+        if (req[i] > need[i]) {
             cout << "Запрос превышает максимальные потребности процессора для ресурса " << i << endl;
             return false; // Запрос превышает максимальные потребности
         }
     }
     // Проверка, достаточно ли доступных ресурсов для выполнения запроса
     for (int i = 0; i < bank->numResources; i++) {
-        bool ok;
-        int req = Get(request, i, ok); // запрошенные ресурсы
-        int avail = Get(bank->avail, i, ok); // доступные ресурсы
-        if (req > avail) {
+        if (req[i] > avail[i]) {
             cout << "Недостаточно доступных ресурсов процессора для ресурса " << i << endl;
             return false; // Недостаточно доступных ресурсов
         }
     }
     // Выделение ресурсов, если проверки пройдены
     for (int i = 0; i < bank->numResources; i++) {
-        bool ok;
-        int req = Get(request, i, ok); // получаем значение запрошенного ресурса
-        int alloc = GetElement(bank->alloc, process, i, ok); // получаем значение выделенных ресурсов для процесса
-        SetElement(bank->alloc, process, i, alloc + req); // устанавливаем новое значение выделенных ресурсов для процесса
-        int avail = Get(bank->avail, i, ok); // получаем значение доступного ресурса
-        Set(bank->avail, avail - req, i); // устанавливаем новое значение доступных ресурсов для процесса
+        alloc[i] += req[i];
+        need[i] -= req[i];
+        avail[i] -= req[i];
     }
+    MarkChanged(bank, req);
 
     return true;
 }
 
-// Проверка, является ли текущее состояние системы безопасным
-pair<bool, vector<int>> isSafeState(Bank* bank) {
-    // Создаем вектор work, который будет использоваться для отслеживания доступных ресурсов
-    Vector* work = NewVector(bank->numResources);
-    // Инициализируем вектор work текущими доступными ресурсами
+// Возвращаем ресурсы, выделенные процессу (обратная операция к requestResources)
+bool releaseResources(Bank* bank, int process, Vector* release) {
+    int* rel = release->data;
+    int* need = Row(bank->need, process);
+    int* alloc = Row(bank->alloc, process);
+    int* avail = bank->avail->data;
+    for (int i = 0; i < bank->numResources; i++) {
+        if (rel[i] > alloc[i]) {
+            return false; // Процесс не держит столько ресурса i
+        }
+    }
     for (int i = 0; i < bank->numResources; i++) {
-        bool ok;
-        int avail = Get(bank->avail, i, ok);
-        Set(work, avail, i);
+        alloc[i] -= rel[i];
+        need[i] += rel[i];
+        avail[i] += rel[i];
+    }
+    MarkChanged(bank, rel);
+    return true;
+}
+
+// Просмотр строк Need; векторные версии компилируются через атрибут target и
+// выбираются во время выполнения по activeKernels из kernel_set.h, как в 2number.cpp
+// Первый ресурс j в [from, m), которого процессу не хватает (need[j] > work[j]), или m.
+// Строки need и work дополнены нулями до stride, кратного 16, поэтому векторные версии
+// читают целые блоки от from, округленного вниз, и маскируют элементы до from;
+// дополнение никогда не дает need > work.
+int firstUnsatisfiedScalar(const int* need, const int* work, int from, int m) {
+    for (int j = from; j < m; j++) {
+        if (need[j] > work[j]) {
+            return j;
+        }
+    }
+    return m;
+}
+
+#ifdef KERNEL_SET_X86
+__attribute__((target("avx2"))) int firstUnsatisfiedAvx2(const int* need, const int* work, int from, int m) {
+    int base = from & ~7;
+    uint32_t skip = (1u << (from - base)) - 1;
+    for (; base < m; base += 8) {
+        __m256i greater = _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(need + base)),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(work + base)));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(greater))) & ~skip;
+        skip = 0;
+        if (mask != 0) {
+            return min(m, base + countr_zero(mask));
+        }
+    }
+    return m;
+}
+
+__attribute__((target("avx512f"))) int firstUnsatisfiedAvx512(const int* need, const int* work, int from, int m) {
+    int base = from & ~15;
+    uint32_t skip = (1u << (from - base)) - 1;
+    for (; base < m; base += 16) {
+        uint32_t mask = _mm512_cmpgt_epi32_mask(_mm512_loadu_si512(need + base), _mm512_loadu_si512(work + base)) & ~skip;
+        skip = 0;
+        if (mask != 0) {
+            return min(m, base + countr_zero(mask));
+        }
+    }
+    return m;
+}
+#endif
+
+inline int firstUnsatisfied(const int* need, const int* work, int from, int m) {
+#ifdef KERNEL_SET_X86
+    if (activeKernels == KernelSet::Avx512) {
+        return firstUnsatisfiedAvx512(need, work, from, m);
+    }
+    if (activeKernels == KernelSet::Avx2) {
+        return firstUnsatisfiedAvx2(need, work, from, m);
+    }
+#endif
+    return firstUnsatisfiedScalar(need, work, from, m);
+}
+
+// Может ли процесс завершиться: need[j] <= work[j] для всех ресурсов.
+// work должен быть дополнен нулями до stride матрицы, как строки need.
+bool canFinish(const int* need, const int* work, int numResources) {
+    return firstUnsatisfied(need, work, 0, numResources) == numResources;
+}
+
+// Меньше стольких элементов Need после верного префикса пул не будится: его
+// пробуждение дороже самого просмотра
+constexpr size_t parallelScanMin = 1 << 18;
+
+// Постоянный пул для предварительного просмотра в isSafeState, как WorkerPool в
+// 1number.cpp: потоки создаются один раз и спят на condition_variable, поэтому пул
+// можно отдавать в каждую проверку после запроса или пачки, а не только в разовую
+// проверку с нуля. Вызывающий поток участвует в запуске под номером 0.
+class ScanPool {
+public:
+    explicit ScanPool(int numThreads) {
+        for (int t = 1; t < numThreads; t++) {
+            workers.emplace_back([this, t]() { workerLoop(t); });
+        }
+    }
+
+    ~ScanPool() {
+        {
+            lock_guard<mutex> lock(poolMutex);
+            stopping = true;
+        }
+        wakeCv.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    ScanPool(const ScanPool&) = delete;
+    ScanPool& operator=(const ScanPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    // job(t) для каждого t из [0, size()); возвращается, когда закончили все
+    void run(const function<void(int)>& job) {
+        {
+            lock_guard<mutex> lock(poolMutex);
+            currentJob = &job;
+            remaining = static_cast<int>(workers.size());
+            ++generation;
+        }
+        wakeCv.notify_all();
+        job(0);
+        unique_lock<mutex> lock(poolMutex);
+        doneCv.wait(lock, [this]() { return remaining == 0; });
+        currentJob = nullptr;
+    }
+
+private:
+    void workerLoop(int index) {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            const function<void(int)>* job;
+            {
+                unique_lock<mutex> lock(poolMutex);
+                wakeCv.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                job = currentJob;
+            }
+            (*job)(index);
+            lock_guard<mutex> lock(poolMutex);
+            if (--remaining == 0) {
+                doneCv.notify_one();
+            }
+        }
+    }
+
+    vector<thread> workers;
+    mutex poolMutex;
+    condition_variable wakeCv; // Пробуждение потоков для нового запуска
+    condition_variable doneCv; // Сигнал о завершении запуска
+    const function<void(int)>* currentJob = nullptr;
+    int remaining = 0; // Потоков пула, еще не закончивших запуск
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+// Проверка, является ли текущее состояние системы безопасным.
+//
+// Процессы перебираются по порядку: по прежней безопасной последовательности
+// (bank->safeSequence), а без нее - по номерам. Без прежней последовательности ответ
+// совпадает с классическим алгоритмом (проходы по процессам, пока хоть один
+// завершается). С ней из готовых первым завершается тот, кто стоял в ней раньше: пока
+// она верна, ответ с ней совпадает, а нарушенная она меняется минимально - процесс,
+// которому теперь не хватает, сдвигается ровно до момента, когда ему хватит.
+//
+// Прежняя последовательность перепроверяется только по измененным ресурсам
+// (bank->changed): по остальным ни need, ни work ни на одном шаге не изменились.
+// Запрос процесса на шаге q уменьшает work на всех шагах до q, поэтому проверять
+// приходится всю последовательность, но по одному столбцу - O(n) на ресурс. Верный
+// префикс принимается без поиска. Если изменено много ресурсов, префикс проверяется
+// построчно, O(n * m).
+//
+// Дальше указатель идет по порядку и завершает процессы, которым хватает work. Кому не
+// хватает, откладывается: он просматривает ресурсы по порядку с позиции pos[i] и на
+// первом ресурсе j, которого не хватает (need[i][j] > work[j]), встает в кучу
+// ожидающих ресурса j с ключом need[i][j]. Рост work[j] снимает с вершины кучи j
+// только тех, кому теперь хватает, и они продолжают просмотр с j + 1: ресурсы до pos[i]
+// уже были удовлетворены, а work не убывает. Готовые отложенные ждут в куче с ключом
+// (проход, место в порядке); без прежней последовательности проход - тот, на котором
+// до процесса дошел бы классический алгоритм. Каждый процесс просматривает свою
+// строку один раз: O(n * m) сравнений и не больше n * m операций с кучами.
+//
+// При большом (n - valid) * m строки после верного префикса заранее просматриваются
+// потоками pool, каждый - свой непрерывный диапазон порядка. Поток считает work так,
+// как если бы все процессы до его диапазона уже завершились (суммы выделенного по
+// диапазонам - отдельный параллельный проход), и добавляет выделенное процессам,
+// которые предложил сам. Для каждой строки он предлагает позицию pos[i]; pos[i] == m -
+// процесс завершится, как только до него дойдет указатель. Основной цикл принимает
+// предложения по порядку перебора: дойдя до начала диапазона, он проверяет, что все
+// процессы до него завершены, - тогда work в точности тот, что у потока, и
+// предложенные процессы диапазона завершаются без повторного просмотра строки, а
+// остальные позиции - нижние границы (work только растет). Иначе предложения диапазона
+// отбрасываются. Поэтому ответ тот же, что без пула, при любом числе потоков.
+pair<bool, vector<int>> isSafeState(Bank* bank, ScanPool* pool = nullptr) {
+    int n = bank->numProcesses;
+    int m = bank->numResources;
+    const vector<int>& previous = bank->safeSequence;
+    bool hasPrevious = static_cast<int>(previous.size()) == n;
+
+    // Верный префикс прежней последовательности по измененным столбцам
+    bool byColumns = hasPrevious && bank->changedResources.size() * 8 <= static_cast<size_t>(m);
+    int valid = 0;
+    if (byColumns) {
+        valid = n;
+        for (int j : bank->changedResources) {
+            int available = bank->avail->data[j];
+            for (int k = 0; k < valid; k++) {
+                int i = previous[k];
+                if (Row(bank->need, i)[j] > available) {
+                    valid = k;
+                    break;
+                }
+                available += Row(bank->alloc, i)[j];
+            }
+        }
+        if (valid == n) {
+            ClearChanged(bank);
+            return {true, previous};
+        }
     }
 
-    // Создаем массив finish, который будет отслеживать, завершены ли процессы
-    vector<bool> finish(bank->numProcesses, false);
+    // Создаем вектор work, который будет использоваться для отслеживания доступных ресурсов,
+    // и инициализируем его текущими доступными ресурсами
+    vector<int> work(bank->need->stride, 0); // С нулевым дополнением до stride для векторного просмотра
+    copy(bank->avail->data, bank->avail->data + m, work.begin());
     // Создаем массив safeSequence, который будет хранить безопасную последовательность процессов
     vector<int> safeSequence;
+    safeSequence.reserve(n);
 
-    // Основной цикл для поиска безопасной последовательности
-    while (true) {
-        bool found = false;
-        // Проходим по всем процессам
-        for (int i = 0; i < bank->numProcesses; i++) {
-            // Если процесс еще не завершен
-            if (!finish[i]) {
-                bool canFinish = true;
-                // Проверяем, может ли процесс завершиться с текущими доступными ресурсами
-                for (int j = 0; j < bank->numResources; j++) {
-                    bool ok;
-                    int need = GetElement(bank->max, i, j, ok) - GetElement(bank->alloc, i, j, ok);
-                    int workVal = Get(work, j, ok);
-                    // Если потребность процесса превышает доступные ресурсы, процесс не может завершиться
-                    if (need > workVal) {
-                        canFinish = false;
-                        break;
+    auto release = [&](int i) {
+        int* alloc = Row(bank->alloc, i);
+        for (int j = 0; j < m; j++) {
+            work[j] += alloc[j];
+        }
+        safeSequence.push_back(i);
+    };
+
+    // Принимаем верный префикс; при многих измененных ресурсах он ищется построчно
+    if (byColumns) {
+        for (int k = 0; k < valid; k++) {
+            release(previous[k]);
+        }
+    } else if (hasPrevious) {
+        while (valid < n && canFinish(Row(bank->need, previous[valid]), work.data(), m)) {
+            release(previous[valid++]);
+        }
+        if (valid == n) {
+            ClearChanged(bank);
+            return {true, previous};
+        }
+    }
+
+    // Порядок перебора: прежняя последовательность или номера процессов
+    auto order = [&](int k) { return hasPrevious ? previous[k] : k; };
+    vector<int> rank(n);
+    for (int k = 0; k < n; k++) {
+        rank[order(k)] = k;
+    }
+
+    using Waiter = pair<int, int>; // (need[i][j], i)
+    using Key = pair<int, int>;    // (проход, место в порядке)
+    vector<priority_queue<Waiter, vector<Waiter>, greater<Waiter>>> waiting(m);
+    priority_queue<Key, vector<Key>, greater<Key>> ready;
+    vector<int> pos(n, 0);
+    int currentPass = 0;
+    int currentRank = valid - 1;
+
+    // Продолжаем просмотр строки процесса: либо он встает в очередь ресурса, либо готов
+    auto scan = [&](int i) {
+        pos[i] = firstUnsatisfied(Row(bank->need, i), work.data(), pos[i], m);
+        if (pos[i] < m) {
+            waiting[pos[i]].push({Row(bank->need, i)[pos[i]], i});
+        } else if (hasPrevious) {
+            ready.push({0, rank[i]});
+        } else {
+            ready.push({rank[i] > currentRank ? currentPass : currentPass + 1, rank[i]});
+        }
+    };
+    // Завершаем процесс и будим ожидающих выросших ресурсов
+    auto finish = [&](int i) {
+        release(i);
+        int* alloc = Row(bank->alloc, i);
+        for (int j = 0; j < m; j++) {
+            while (alloc[j] > 0 && !waiting[j].empty() && waiting[j].top().first <= work[j]) {
+                int waiter = waiting[j].top().second;
+                waiting[j].pop();
+                pos[waiter]++;
+                scan(waiter);
+            }
+        }
+    };
+
+    // Предложения потоков пула. Сначала каждый поток суммирует выделенное процессам своего
+    // диапазона, затем просматривает диапазон с work, как если бы все процессы до него
+    // уже завершились, добавляя выделенное предложенным
+    vector<int> rangeBegin{n}; // Начала диапазонов, где основной цикл проверяет предложения, и n
+    if (pool != nullptr && pool->size() > 1 && static_cast<size_t>(n - valid) * m >= parallelScanMin) {
+        int numThreads = pool->size();
+        rangeBegin.resize(numThreads + 1);
+        for (int t = 0; t <= numThreads; t++) {
+            rangeBegin[t] = valid + static_cast<int>(static_cast<int64_t>(n - valid) * t / numThreads);
+        }
+        vector<vector<int>> local(numThreads, vector<int>(work.size(), 0));
+        pool->run([&](int t) {
+            for (int k = rangeBegin[t]; k < rangeBegin[t + 1]; k++) {
+                int* alloc = Row(bank->alloc, order(k));
+                for (int j = 0; j < m; j++) {
+                    local[t][j] += alloc[j];
+                }
+            }
+        });
+        // local[t] - work в начале диапазона t при завершенных процессах до него
+        for (int t = numThreads - 1; t > 0; t--) {
+            local[t] = local[t - 1];
+        }
+        local[0] = work;
+        for (int t = 1; t < numThreads; t++) {
+            for (int j = 0; j < m; j++) {
+                local[t][j] += local[t - 1][j];
+            }
+        }
+        pool->run([&](int t) {
+            for (int k = rangeBegin[t]; k < rangeBegin[t + 1]; k++) {
+                int i = order(k);
+                pos[i] = firstUnsatisfied(Row(bank->need, i), local[t].data(), 0, m);
+                if (pos[i] == m) {
+                    int* alloc = Row(bank->alloc, i);
+                    for (int j = 0; j < m; j++) {
+                        local[t][j] += alloc[j];
                     }
                 }
-                // Если процесс может завершиться
-                if (canFinish) {
-                    // Освобождаем ресурсы, выделенные процессу
-                    for (int j = 0; j < bank->numResources; j++) {
-                        bool ok;
-                        int alloc = GetElement(bank->alloc, i, j, ok);
-                        int workVal = Get(work, j, ok);
-                        Set(work, workVal + alloc, j);
+            }
+        });
+        rangeBegin.erase(rangeBegin.begin()); // Диапазон 0 начинается с верного префикса
+    }
+    size_t nextRange = 0;
+
+    // Основной цикл: готовый отложенный процесс, стоящий в порядке раньше указателя,
+    // завершается первым; иначе указатель берет следующий процесс по порядку
+    int next = valid;
+    while (true) {
+        if (!ready.empty() && (next == n || ready.top() < Key{0, next})) {
+            auto [pass, k] = ready.top();
+            ready.pop();
+            currentPass = pass;
+            currentRank = k;
+            finish(order(k));
+        } else if (next < n) {
+            if (next == rangeBegin[nextRange]) {
+                // Предложения диапазона верны, только если все процессы до него завершены
+                if (static_cast<int>(safeSequence.size()) != next) {
+                    for (int k = next; k < rangeBegin[nextRange + 1]; k++) {
+                        pos[order(k)] = 0;
                     }
-                    // Помечаем процесс как завершенный
-                    finish[i] = true;
-                    // Добавляем процесс в безопасную последовательность
-                    safeSequence.push_back(i);
-                    found = true;
                 }
+                nextRange++;
             }
-        }
-        // Если не найдено ни одного процесса, который может завершиться, выходим из цикла
-        if (!found) {
+            int i = order(next);
+            currentRank = next++;
+            pos[i] = firstUnsatisfied(Row(bank->need, i), work.data(), pos[i], m);
+            if (pos[i] == m) {
+                finish(i);
+            } else {
+                waiting[pos[i]].push({Row(bank->need, i)[pos[i]], i});
+            }
+        } else {
             break;
         }
     }
 
     // Проверяем, все ли процессы завершены
-    for (int i = 0; i < bank->numProcesses; i++) {
-        if (!finish[i]) {
-            return {false, {}};
-        }
+    if (static_cast<int>(safeSequence.size()) != n) {
+        return {false, {}};
     }
 
     // Возвращаем true и безопасную последовательность, если все процессы могут завершиться
+    bank->safeSequence = safeSequence;
+    ClearChanged(bank);
     return {true, safeSequence};
 }
 
-int main() {
+// Случайный банк для больших замеров. Безопасная последовательность задается заранее
+// случайной перестановкой order: у процесса order[k] потребность по одному ресурсу
+// ровно равна work после завершения order[0..k-1], а выделено каждому процессу не
+// меньше единицы каждого ресурса. Поэтому процесс может завершиться не раньше своего
+// шага (с точностью до запаса slack в avail), и поиск обходит процессы много раз.
+Bank* RandomBank(int numProcesses, int numResources, uint64_t seed, int slack = 0) {
+    Xoshiro256 gen(seed);
+    Matrix* max = NewMatrix(numProcesses, numResources);
+    Matrix* alloc = NewMatrix(numProcesses, numResources);
+    Vector* avail = NewVector(numResources);
+    vector<int> order(numProcesses);
+    for (int i = 0; i < numProcesses; i++) {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), gen);
+
+    vector<int> work(numResources);
+    for (int j = 0; j < numResources; j++) {
+        work[j] = 1 + static_cast<int>(gen.nextBelow(10));
+        avail->data[j] = work[j];
+    }
+    for (int process : order) {
+        int* maxRow = Row(max, process);
+        int* allocRow = Row(alloc, process);
+        int tight = static_cast<int>(gen.nextBelow(numResources)); // Ресурс, который держит процесс до его шага
+        for (int j = 0; j < numResources; j++) {
+            int need = j == tight ? work[j] : static_cast<int>(gen.nextBelow(work[j] + 1));
+            allocRow[j] = 1 + static_cast<int>(gen.nextBelow(10));
+            maxRow[j] = allocRow[j] + need;
+        }
+        for (int j = 0; j < numResources; j++) {
+            work[j] += allocRow[j];
+        }
+    }
+    for (int j = 0; j < numResources; j++) {
+        avail->data[j] += slack;
+    }
+    return NewBank(max, alloc, avail, numProcesses, numResources);
+}
+
+void DeleteBank(Bank* bank) {
+    DeleteMatrix(bank->max);
+    DeleteMatrix(bank->alloc);
+    DeleteMatrix(bank->need);
+    DeleteVector(bank->avail);
+    delete bank;
+}
+
+// Замер проверки безопасности на случайном банке (--random): первая проверка с нуля, затем
+// requests случайных запросов по единице ресурса, каждый с проверкой и откатом при
+// небезопасном состоянии. Запас в avail дает запросам проходить.
+//
+// Прежняя последовательность сохраняется, если запрос не уперся в нулевой запас ни на
+// одном шаге до запросившего процесса; тогда проверка стоит O(n). В этом банке каждый
+// процесс держит каждый ресурс, а последовательность завершает процессы при первой
+// возможности, поэтому нулевой запас встречается часто: при 20000 x 200 сохраняется
+// около трети выдач, при 2000 x 2000 - почти все. Иначе проверка стоит O((n - q) * m)
+// от первого нарушенного шага q.
+//
+// Все проверки, и первая, и после запросов, идут с пулом из numThreads потоков (--threads).
+int runRandomBank(int numProcesses, int numResources, uint64_t seed, int requests, int numThreads) {
+    Bank* bank = RandomBank(numProcesses, numResources, seed, requests > 0 ? 20 : 0);
+    ScanPool pool(numThreads);
+    auto start = chrono::high_resolution_clock::now();
+    auto [isSafe, safeSequence] = isSafeState(bank, &pool);
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    cout << "Процессов: " << numProcesses << ", ресурсов: " << numResources << ", проверка безопасности: "
+         << elapsed.count() << " сек" << endl;
+    cout << (isSafe ? "Система находится в безопасном состоянии." : "Система находится в небезопасном состоянии.")
+         << endl;
+
+    // Сверка с однопоточным скалярным просмотром: последовательность обязана совпасть
+    if (numThreads > 1 || activeKernels != KernelSet::Scalar) {
+        KernelSet savedKernels = activeKernels;
+        activeKernels = KernelSet::Scalar;
+        bank->safeSequence.clear();
+        start = chrono::high_resolution_clock::now();
+        auto reference = isSafeState(bank);
+        chrono::duration<double> referenceElapsed = chrono::high_resolution_clock::now() - start;
+        activeKernels = savedKernels;
+        bool same = reference.first == isSafe && reference.second == safeSequence;
+        cout << "Однопоточная скалярная проверка: " << referenceElapsed.count() << " сек, результат "
+             << (same ? "совпадает" : "РАСХОДИТСЯ") << endl;
+        bank->safeSequence = safeSequence;
+        if (!same) {
+            DeleteBank(bank);
+            return 1;
+        }
+    }
+
+    Xoshiro256 gen(seed ^ 0x72657175657374ULL);
+    Vector* request = NewVector(numResources);
+    int granted = 0;
+    int kept = 0;
+    int checks = 0; // Запросы, дошедшие до проверки; остальные пропущены без нее
+    elapsed = {};
+    for (int r = 0; r < requests && isSafe; r++) {
+        int process = static_cast<int>(gen.nextBelow(numProcesses));
+        int resource = static_cast<int>(gen.nextBelow(numResources));
+        if (Row(bank->need, process)[resource] == 0 || bank->avail->data[resource] == 0) {
+            continue;
+        }
+        request->data[resource] = 1;
+        requestResources(bank, process, request);
+        vector<int> previous = bank->safeSequence;
+        start = chrono::high_resolution_clock::now();
+        bool safe = isSafeState(bank, &pool).first;
+        elapsed += chrono::high_resolution_clock::now() - start;
+        checks++;
+        if (safe) {
+            granted++;
+            kept += bank->safeSequence == previous;
+        } else {
+            releaseResources(bank, process, request); // Небезопасный запрос не выдается
+        }
+        request->data[resource] = 0;
+    }
+    if (requests > 0) {
+        cout << "Запросов: " << requests << ", проверено: " << checks << ", выдано: " << granted
+             << ", безопасная последовательность сохранилась: " << kept
+             << ", средняя проверка: " << elapsed.count() / max(1, checks) * 1e6 << " мкс" << endl;
+    }
+    DeleteVector(request);
+    DeleteBank(bank);
+    return isSafe ? 0 : 1;
+}
+
+// Потокобезопасный банк. Запросы и возвраты ставятся в очередь; поток, заставший
+// очередь без обработчика, сам становится обработчиком и разбирает ее пачками, пока
+// она не опустеет. Состояние банка трогает только текущий обработчик, поэтому на
+// пачку нужна одна проверка безопасности вместо проверки на каждый запрос.
+//
+// Допуск пачки: сначала применяются возвраты, затем запросы - ранее отложенные и
+// новые в порядке поступления; не помещающиеся в avail откладываются сразу. Если
+// безопасно выдать все сразу (обычный случай) - одна проверка. Иначе двоичным поиском
+// находится наибольший безопасный префикс, а остальные пробуются по одному. Точный
+// наибольший безопасный поднабор требует перебора, префикс с догоном дает максимальный
+// по включению и гарантирует продвижение: процесс, первый в безопасной
+// последовательности, всегда будет выдан. Отложенные запросы повторяются в каждой
+// следующей пачке, в том числе вызванной возвратом.
+//
+// Проверки пачек идут с собственным пулом из scanThreads потоков; он включается
+// только при большом банке (parallelScanMin).
+class ConcurrentBank {
+public:
+    explicit ConcurrentBank(Bank* bank, int scanThreads = 1) : bank(bank), pool(scanThreads) {}
+
+    // Ждет выдачи; false - запрос превышает оставшуюся потребность процесса
+    bool request(int process, const int* amounts) {
+        Operation op{process, amounts, false};
+        submit(op);
+        return op.granted;
+    }
+
+    // false - процесс не держит столько ресурсов
+    bool release(int process, const int* amounts) {
+        Operation op{process, amounts, true};
+        submit(op);
+        return op.granted;
+    }
+
+    // Счетчики читаются после остановки всех вызывающих потоков
+    long long batches = 0;      // Обработанных пачек с запросами
+    long long batchRequests = 0; // Запросов, рассмотренных в пачках (с повторами отложенных)
+    long long safetyChecks = 0; // Вызовов isSafeState
+
+private:
+    struct Operation {
+        int process;
+        const int* amounts;
+        bool isRelease;
+        bool granted = false;
+        binary_semaphore done{0};
+    };
+
+    void submit(Operation& op) {
+        unique_lock<mutex> lock(queueMutex);
+        queue.push_back(&op);
+        if (!admitting) {
+            admitting = true;
+            while (!queue.empty()) {
+                vector<Operation*> batch;
+                batch.swap(queue);
+                lock.unlock();
+                admit(batch);
+                lock.lock();
+            }
+            admitting = false;
+        }
+        lock.unlock();
+        op.done.acquire(); // Свою операцию мог завершить и другой обработчик
+    }
+
+    static void complete(Operation* op, bool granted) {
+        op->granted = granted;
+        op->done.release(); // После этого op может быть уничтожен
+    }
+
+    // Выдача (sign = 1) или возврат (sign = -1) без проверок
+    void apply(const Operation* op, int sign) {
+        int* alloc = Row(bank->alloc, op->process);
+        int* need = Row(bank->need, op->process);
+        int* avail = bank->avail->data;
+        for (int j = 0; j < bank->numResources; j++) {
+            int amount = sign * op->amounts[j];
+            alloc[j] += amount;
+            need[j] -= amount;
+            avail[j] -= amount;
+        }
+        MarkChanged(bank, op->amounts);
+    }
+
+    bool fits(const int* amounts, const int* limit) const {
+        for (int j = 0; j < bank->numResources; j++) {
+            if (amounts[j] > limit[j]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool checkSafe() {
+        safetyChecks++;
+        return isSafeState(bank, &pool).first;
+    }
+
+    void admit(const vector<Operation*>& batch) {
+        vector<Operation*> candidates;
+        candidates.swap(blocked);
+        for (Operation* op : batch) {
+            if (!op->isRelease) {
+                candidates.push_back(op);
+            } else if (fits(op->amounts, Row(bank->alloc, op->process))) {
+                apply(op, -1);
+                complete(op, true);
+            } else {
+                complete(op, false);
+            }
+        }
+        if (candidates.empty()) {
+            return;
+        }
+        batches++;
+        batchRequests += candidates.size();
+
+        // Предварительная выдача всего, что помещается в avail; не поместившиеся
+        // после предыдущих (deferred) повторяются, если выдачу придется откатить
+        vector<Operation*> feasible;
+        vector<Operation*> deferred;
+        for (Operation* op : candidates) {
+            if (!fits(op->amounts, Row(bank->need, op->process))) {
+                complete(op, false);
+            } else if (fits(op->amounts, bank->avail->data)) {
+                apply(op, 1);
+                feasible.push_back(op);
+            } else {
+                deferred.push_back(op);
+            }
+        }
+        if (feasible.empty() || checkSafe()) {
+            for (Operation* op : feasible) {
+                complete(op, true);
+            }
+            blocked.insert(blocked.end(), deferred.begin(), deferred.end());
+            return;
+        }
+        for (size_t k = feasible.size(); k-- > 0;) {
+            apply(feasible[k], -1);
+        }
+
+        // Наибольший безопасный префикс: пустой безопасен, полный - нет
+        size_t lo = 0;
+        size_t hi = feasible.size();
+        while (hi - lo > 1) {
+            size_t mid = (lo + hi) / 2;
+            for (size_t k = 0; k < mid; k++) {
+                apply(feasible[k], 1);
+            }
+            (checkSafe() ? lo : hi) = mid;
+            for (size_t k = mid; k-- > 0;) {
+                apply(feasible[k], -1);
+            }
+        }
+        for (size_t k = 0; k < lo; k++) {
+            apply(feasible[k], 1);
+        }
+        // Остальные и отложенные - по одному поверх выданного префикса
+        vector<Operation*> granted(feasible.begin(), feasible.begin() + lo);
+        feasible.insert(feasible.end(), deferred.begin(), deferred.end());
+        for (size_t k = lo; k < feasible.size(); k++) {
+            Operation* op = feasible[k];
+            if (!fits(op->amounts, bank->avail->data)) {
+                blocked.push_back(op);
+                continue;
+            }
+            apply(op, 1);
+            if (checkSafe()) {
+                granted.push_back(op);
+            } else {
+                apply(op, -1);
+                blocked.push_back(op);
+            }
+        }
+        for (Operation* op : granted) {
+            complete(op, true);
+        }
+    }
+
+    Bank* bank;
+    ScanPool pool; // Потоки проверки; их запускает только текущий обработчик
+    mutex queueMutex;
+    vector<Operation*> queue; // Новые операции; защищено queueMutex
+    bool admitting = false;   // Есть обработчик; защищено queueMutex
+    vector<Operation*> blocked; // Отложенные запросы; только у обработчика
+};
+
+// Банк для замера сервиса: по процессу на поток, Max случайный от 1 до 10, ничего не
+// выдано. Каждого ресурса - половина суммарной потребности, но не меньше наибольшей,
+// так что любой процесс может завершиться в одиночку, а вместе они конкурируют.
+Bank* ServiceBank(int numProcesses, int numResources, uint64_t seed) {
+    Xoshiro256 gen(seed);
+    Matrix* max = NewMatrix(numProcesses, numResources);
+    Matrix* alloc = NewMatrix(numProcesses, numResources);
+    Vector* avail = NewVector(numResources);
+    for (int j = 0; j < numResources; j++) {
+        int total = 0;
+        int largest = 0;
+        for (int i = 0; i < numProcesses; i++) {
+            int value = 1 + static_cast<int>(gen.nextBelow(10));
+            Row(max, i)[j] = value;
+            total += value;
+            largest = std::max(largest, value);
+        }
+        avail->data[j] = std::max(largest, total / 2);
+    }
+    return NewBank(max, alloc, avail, numProcesses, numResources);
+}
+
+// Замер сервиса: для каждого числа потоков поток-процесс в течение seconds запрашивает
+// случайные порции (до 3 единиц ресурса) оставшейся потребности, а получив все до Max,
+// возвращает все и начинает заново. Задержка - от вызова request до выдачи.
+// scanThreads - потоки пула проверки безопасности (--threads).
+int runConcurrentBenchmark(const vector<int>& threadCounts, int numResources, double seconds, uint64_t seed,
+                           int scanThreads) {
+    cout << "threads,requests_per_sec,p50_us,p99_us,batches,requests_per_batch,checks_per_batch" << endl;
+    for (int numThreads : threadCounts) {
+        Bank* bank = ServiceBank(numThreads, numResources, seed);
+        vector<int> total(bank->avail->data, bank->avail->data + numResources);
+        ConcurrentBank service(bank, scanThreads);
+        vector<vector<double>> latencies(numThreads);
+        vector<long long> rejected(numThreads, 0);
+        auto deadline = chrono::steady_clock::now() + chrono::duration<double>(seconds);
+
+        auto worker = [&](int process) {
+            Xoshiro256 gen(seed + 1 + process);
+            vector<int> need(Row(bank->max, process), Row(bank->max, process) + numResources);
+            vector<int> held(numResources, 0);
+            vector<int> amounts(numResources);
+            while (chrono::steady_clock::now() < deadline) {
+                bool any = false;
+                for (int j = 0; j < numResources; j++) {
+                    amounts[j] = static_cast<int>(gen.nextBelow(min(need[j], 3) + 1));
+                    any = any || amounts[j] > 0;
+                }
+                if (!any) {
+                    int j = static_cast<int>(find_if(need.begin(), need.end(), [](int v) { return v > 0; }) -
+                                             need.begin());
+                    if (j == numResources) {
+                        service.release(process, held.data()); // Процесс получил все и завершился
+                        need.assign(Row(bank->max, process), Row(bank->max, process) + numResources);
+                        fill(held.begin(), held.end(), 0);
+                        continue;
+                    }
+                    amounts[j] = 1;
+                }
+                auto start = chrono::steady_clock::now();
+                bool granted = service.request(process, amounts.data());
+                latencies[process].push_back(
+                    chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+                if (!granted) {
+                    rejected[process]++;
+                    continue;
+                }
+                for (int j = 0; j < numResources; j++) {
+                    need[j] -= amounts[j];
+                    held[j] += amounts[j];
+                }
+            }
+            service.release(process, held.data()); // Иначе ждущие соседи не дождутся
+        };
+        vector<thread> threads;
+        for (int t = 0; t < numThreads; t++) {
+            threads.emplace_back(worker, t);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        // После возврата всего банк должен вернуться к исходному avail
+        vector<double> all;
+        for (const auto& values : latencies) {
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        bool balanced = equal(total.begin(), total.end(), bank->avail->data);
+        long long rejectedTotal = accumulate(rejected.begin(), rejected.end(), 0LL);
+        if (!balanced || rejectedTotal > 0) {
+            cerr << "Ошибка сервиса банка при потоках " << numThreads << ": отклонено " << rejectedTotal
+                 << (balanced ? "" : ", ресурсы не сошлись") << endl;
+            DeleteBank(bank);
+            return 1;
+        }
+        sort(all.begin(), all.end());
+        auto percentile = [&](double q) {
+            return all.empty() ? 0.0 : all[min(all.size() - 1, static_cast<size_t>(q * all.size()))];
+        };
+        double batches = max<long long>(1, service.batches);
+        cout << numThreads << ',' << all.size() / seconds << ',' << percentile(0.5) << ',' << percentile(0.99) << ','
+             << service.batches << ',' << service.batchRequests / batches << ',' << service.safetyChecks / batches
+             << endl;
+        DeleteBank(bank);
+    }
+    return 0;
+}
+
+// Разбор целого числа не меньше minValue; строка должна быть числом целиком
+bool parseInt(const string& text, int minValue, int& out) {
+    try {
+        size_t pos = 0;
+        int value = stoi(text, &pos);
+        if (pos != text.size() || value < minValue) {
+            return false;
+        }
+        out = value;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Разбор вещественного числа больше minValue
+bool parseDouble(const string& text, double minValue, double& out) {
+    try {
+        size_t pos = 0;
+        double value = stod(text, &pos);
+        if (pos != text.size() || !(value > minValue)) {
+            return false;
+        }
+        out = value;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Разбор зерна: десятичное, 0x... или 0...; знак не допускается, иначе stoull молча заворачивает -1
+bool parseSeed(const string& text, uint64_t& out) {
+    try {
+        size_t pos = 0;
+        if (text.empty() || text[0] == '-' || text[0] == '+') {
+            return false;
+        }
+        uint64_t value = stoull(text, &pos, 0);
+        if (pos != text.size()) {
+            return false;
+        }
+        out = value;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Список положительных чисел через запятую: "1,2,4,8"
+bool parseIntList(const string& text, vector<int>& out) {
+    vector<int> values;
+    size_t pos = 0;
+    while (true) {
+        size_t comma = text.find(',', pos);
+        int value;
+        if (!parseInt(text.substr(pos, comma - pos), 1, value)) {
+            return false;
+        }
+        values.push_back(value);
+        if (comma == string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+    out = values;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // Большой случайный банк вместо учебного примера:
+    //   --random ПРОЦЕССЫ РЕСУРСЫ [--seed N] [--requests K] [--threads T] [--kernels auto|scalar|avx2|avx512]
+    // Замер потокобезопасного банка:
+    //   --concurrent СПИСОК_ПОТОКОВ [--resources R] [--seconds S] [--seed N] [--threads T]
+    // --threads в обоих режимах - потоки пула проверки безопасности
+    if (argc >= 2) {
+        string mode = argv[1];
+        uint64_t seed = 1;
+        int requests = 0;
+        int resources = 16;
+        double seconds = 0.5;
+        int safetyThreads = 1;
+        int numProcesses = 0;
+        int numResources = 0;
+        vector<int> threadCounts;
+        bool random = mode == "--random" && argc >= 4 && parseInt(argv[2], 1, numProcesses) &&
+                      parseInt(argv[3], 1, numResources);
+        bool concurrent = mode == "--concurrent" && argc >= 3 && parseIntList(argv[2], threadCounts);
+        bool ok = random || concurrent;
+        // Разборщики сами записывают значение, поэтому у принятых опций пустые ветви
+        for (int i = random ? 4 : 3; ok && i < argc; i += 2) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--seed" && hasValue && parseSeed(argv[i + 1], seed)) {
+            } else if (random && arg == "--requests" && hasValue && parseInt(argv[i + 1], 0, requests)) {
+            } else if (arg == "--threads" && hasValue && parseInt(argv[i + 1], 1, safetyThreads)) {
+            } else if (random && arg == "--kernels" && hasValue && parseKernelSet(argv[i + 1], activeKernels)) {
+                // Набор уже записан в activeKernels
+            } else if (concurrent && arg == "--resources" && hasValue && parseInt(argv[i + 1], 1, resources)) {
+            } else if (concurrent && arg == "--seconds" && hasValue && parseDouble(argv[i + 1], 0, seconds)) {
+                seconds = max(0.01, seconds);
+            } else {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            cerr << "Использование: " << argv[0]
+                 << " [--random ПРОЦЕССЫ РЕСУРСЫ [--seed N] [--requests K] [--threads T] [--kernels auto|scalar|avx2|avx512]]"
+                 << " [--concurrent 1,2,4,... [--resources R] [--seconds S] [--seed N] [--threads T]]" << endl;
+            return 1;
+        }
+        if (random) {
+            return runRandomBank(numProcesses, numResources, seed, requests, safetyThreads);
+        }
+        return runConcurrentBenchmark(threadCounts, resources, seconds, seed, safetyThreads);
+    }
+
     int numProcesses = 5;
     int numResources = 3;
     Matrix* max = NewMatrix(numProcesses, numResources);
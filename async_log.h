@@ -0,0 +1,335 @@
+#pragma once
+
+// Асинхронный журнал: вывод из критических секций без терминального ввода-вывода.
+//
+// Каждый поток пишет записи фиксированного размера в свой кольцевой буфер
+// (один писатель, один читатель, без блокировок). Единственный фоновый поток
+// забирает записи, форматирует их и выводит пачками. Запись хранит указатель
+// на функцию форматирования и копию небольшой структуры с аргументами, поэтому
+// в горячем пути нет ни форматирования, ни выделения памяти, ни системных вызовов.
+// Буфер завершившегося потока помечается отработавшим; фоновый поток, выведя его
+// записи, кладет буфер в небольшой запас для новых потоков или освобождает.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Режим вывода журнала
+enum class LogMode {
+    Async, // Кольцевые буферы потоков и фоновый поток вывода
+    Sync,  // Форматирование и вывод в std::cout прямо в вызывающем потоке, как раньше
+    Off,   // Вывод отключен полностью
+};
+
+class AsyncLog {
+public:
+    // Размер полезной нагрузки одной записи
+    static constexpr size_t payloadSize = 48;
+
+    static AsyncLog& instance() {
+        static AsyncLog log;
+        return log;
+    }
+
+    // Смена режима; вызывать, когда другие потоки ничего не пишут
+    void setMode(LogMode newMode) {
+        flush();
+        currentMode.store(newMode, std::memory_order_relaxed);
+    }
+
+    LogMode mode() const {
+        return currentMode.load(std::memory_order_relaxed);
+    }
+
+    // Запись в журнал. Payload копируется побайтно, поэтому должен быть тривиально
+    // копируемым; данные, на которые он ссылается, должны жить до flush().
+    template <typename Payload>
+    void write(void (*format)(std::string&, const Payload&), const Payload& payload) {
+        static_assert(std::is_trivially_copyable_v<Payload>, "Payload копируется побайтно");
+        static_assert(sizeof(Payload) <= payloadSize, "Payload не помещается в запись");
+
+        LogMode m = mode();
+        if (m == LogMode::Off) {
+            return;
+        }
+        if (m == LogMode::Sync) {
+            thread_local std::string line;
+            line.clear();
+            format(line, payload);
+            std::cout.write(line.data(), static_cast<std::streamsize>(line.size())) << std::flush;
+            return;
+        }
+
+        Ring& ring = localRing();
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        while (head - ring.tail.load(std::memory_order_acquire) == ringCapacity) {
+            // Буфер полон: будим фоновый поток и ждем, записи не теряются
+            ring.stalls.fetch_add(1, std::memory_order_relaxed);
+            wakeDrainer();
+            std::this_thread::yield();
+        }
+        Record& record = ring.records[head & (ringCapacity - 1)];
+        record.invoke = &invokeFormat<Payload>;
+        record.format = reinterpret_cast<void (*)()>(format);
+        std::memcpy(record.payload, &payload, sizeof(Payload));
+        ring.head.store(head + 1, std::memory_order_release);
+
+        // Буфер стал непустым, а фоновый поток, возможно, уснул: будим его. Барьер
+        // в паре с барьером в drainLoop - либо писатель видит drainerIdle, либо
+        // фоновый поток видит новую запись, прежде чем уснуть.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring.tail.load(std::memory_order_relaxed) == head && drainerIdle.load(std::memory_order_relaxed) &&
+            drainerIdle.exchange(false, std::memory_order_relaxed)) {
+            notifyDrainer();
+        }
+    }
+
+    // Дождаться вывода всех записей, сделанных до вызова
+    void flush() {
+        std::unique_lock<std::mutex> lock(drainMutex);
+        uint64_t target = ++flushRequested;
+        drainCv.notify_one();
+        flushCv.wait(lock, [this, target]() { return flushCompleted >= target; });
+    }
+
+    // Сколько раз писатели ждали из-за переполненного буфера
+    uint64_t stallCount() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        uint64_t total = freedStalls;
+        for (const auto& ring : rings) {
+            total += ring->stalls.load(std::memory_order_relaxed);
+        }
+        for (const auto& ring : freeRings) {
+            total += ring->stalls.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    ~AsyncLog() {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(drainMutex);
+            stopping = true;
+        }
+        drainCv.notify_one();
+        drainer.join();
+    }
+
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+
+private:
+    static constexpr uint64_t ringCapacity = 4096; // Записей в буфере потока (степень двойки)
+    static constexpr size_t batchBytes = 64 * 1024; // Размер пачки вывода
+    static constexpr size_t maxFreeRings = 8;       // Запас буферов завершившихся потоков
+    static constexpr auto activeInterval = std::chrono::milliseconds(1); // Накопление пачки при потоке записей
+    static constexpr auto idleTimeout = std::chrono::seconds(1);         // Страховочное пробуждение простаивающего
+
+    struct alignas(64) Record {
+        void (*invoke)(std::string&, const Record&); // Распаковка payload и вызов format
+        void (*format)();                            // Функция форматирования с типом, стертым до void()
+        alignas(8) unsigned char payload[payloadSize];
+    };
+
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head{0}; // Пишет только владелец буфера
+        alignas(64) std::atomic<uint64_t> tail{0}; // Пишет только фоновый поток
+        std::atomic<uint64_t> stalls{0};
+        std::atomic<bool> retired{false}; // Владелец завершился, новых записей не будет
+        std::unique_ptr<Record[]> records{new Record[ringCapacity]};
+    };
+
+    template <typename Payload>
+    static void invokeFormat(std::string& out, const Record& record) {
+        Payload payload;
+        std::memcpy(&payload, record.payload, sizeof(Payload));
+        reinterpret_cast<void (*)(std::string&, const Payload&)>(record.format)(out, payload);
+    }
+
+    AsyncLog() : drainer([this]() { drainLoop(); }) {}
+
+    // Владение буфером со стороны потока: при завершении потока буфер помечается
+    // отработавшим, а освобождает его фоновый поток после вывода записей
+    struct RingHolder {
+        Ring* ring = nullptr;
+
+        ~RingHolder() {
+            if (ring != nullptr) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    // Буфер текущего потока; регистрируется при первой записи, по возможности из запаса
+    Ring& localRing() {
+        thread_local RingHolder holder;
+        if (holder.ring == nullptr) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            if (freeRings.empty()) {
+                rings.push_back(std::make_unique<Ring>());
+            } else {
+                rings.push_back(std::move(freeRings.back()));
+                freeRings.pop_back();
+                rings.back()->retired.store(false, std::memory_order_relaxed);
+            }
+            holder.ring = rings.back().get();
+        }
+        return *holder.ring;
+    }
+
+    void notifyDrainer() {
+        std::lock_guard<std::mutex> lock(drainMutex);
+        drainCv.notify_one();
+    }
+
+    // Разбудить фоновый поток, в том числе простаивающий: тот ждет сброса drainerIdle
+    void wakeDrainer() {
+        drainerIdle.store(false, std::memory_order_relaxed);
+        notifyDrainer();
+    }
+
+    // Есть ли невыведенные записи; фоновый поток проверяет это перед тем, как уснуть
+    bool hasPending() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const auto& ring : rings) {
+            if (ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Забрать и отформатировать все накопившиеся записи; возвращает их число
+    size_t drainRings(std::string& buffer) {
+        snapshot.clear();
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            // Пустые буферы завершившихся потоков уходят в запас или освобождаются.
+            // retired читается до head: после него владелец уже ничего не пишет.
+            size_t kept = 0;
+            for (auto& ring : rings) {
+                if (ring->retired.load(std::memory_order_acquire) &&
+                    ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_relaxed)) {
+                    if (freeRings.size() < maxFreeRings) {
+                        freeRings.push_back(std::move(ring));
+                    } else {
+                        freedStalls += ring->stalls.load(std::memory_order_relaxed);
+                    }
+                    continue;
+                }
+                snapshot.push_back(ring.get());
+                rings[kept++] = std::move(ring);
+            }
+            rings.resize(kept);
+        }
+        size_t drained = 0;
+        for (Ring* ring : snapshot) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail) {
+                const Record& record = ring->records[tail & (ringCapacity - 1)];
+                record.invoke(buffer, record);
+                if (buffer.size() >= batchBytes) {
+                    writeBatch(buffer);
+                }
+            }
+            drained += head - ring->tail.load(std::memory_order_relaxed);
+            ring->tail.store(head, std::memory_order_release);
+        }
+        return drained;
+    }
+
+    static void writeBatch(std::string& buffer) {
+        if (!buffer.empty()) {
+            std::cout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            std::cout.flush();
+            buffer.clear();
+        }
+    }
+
+    // Пока записи идут, фоновый поток просыпается раз в activeInterval и выводит
+    // накопившееся пачкой. Пройдя вхолостую, он засыпает до записи в пустой буфер,
+    // переполнения, flush() или остановки; в режимах Sync и Off записей в буферы нет,
+    // и он не просыпается вовсе, кроме редкого страховочного idleTimeout.
+    void drainLoop() {
+        std::string buffer;
+        buffer.reserve(batchBytes * 2);
+        bool active = false;
+        while (true) {
+            uint64_t flushTarget;
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(drainMutex);
+                auto woken = [this]() { return stopping || flushRequested != flushCompleted; };
+                if (active) {
+                    drainCv.wait_for(lock, activeInterval, woken);
+                } else {
+                    drainerIdle.store(true, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (!hasPending()) {
+                        drainCv.wait_for(lock, idleTimeout, [this, &woken]() {
+                            return woken() || !drainerIdle.load(std::memory_order_relaxed);
+                        });
+                    }
+                    drainerIdle.store(false, std::memory_order_relaxed);
+                }
+                flushTarget = flushRequested;
+                stop = stopping;
+            }
+
+            size_t drained = 0;
+            while (size_t count = drainRings(buffer)) {
+                drained += count;
+            }
+            writeBatch(buffer);
+            active = drained > 0;
+
+            {
+                std::lock_guard<std::mutex> lock(drainMutex);
+                flushCompleted = flushTarget;
+            }
+            flushCv.notify_all();
+            if (stop) {
+                return;
+            }
+        }
+    }
+
+    std::atomic<LogMode> currentMode{LogMode::Async};
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<Ring>> rings;     // Буферы, которые может писать живой поток
+    std::vector<std::unique_ptr<Ring>> freeRings; // Пустые буферы завершившихся потоков
+    uint64_t freedStalls = 0;                     // Ожидания из уже освобожденных буферов
+    std::vector<Ring*> snapshot;                  // Рабочий список фонового потока
+    std::mutex drainMutex;
+    std::condition_variable drainCv;
+    std::condition_variable flushCv;
+    uint64_t flushRequested = 0;
+    uint64_t flushCompleted = 0;
+    bool stopping = false;
+    std::atomic<bool> drainerIdle{false}; // Фоновый поток уснул до записи в пустой буфер
+    std::thread drainer; // Объявлен последним: запускается, когда остальные поля готовы
+};
+
+// Разбор режима журнала из командной строки: async, sync или off
+inline bool parseLogMode(const std::string& text, LogMode& mode) {
+    if (text == "async") {
+        mode = LogMode::Async;
+    } else if (text == "sync") {
+        mode = LogMode::Sync;
+    } else if (text == "off") {
+        mode = LogMode::Off;
+    } else {
+        return false;
+    }
+    return true;
+}
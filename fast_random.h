@@ -0,0 +1,283 @@
+#pragma once
+
+// Быстрые генераторы случайных чисел с независимыми потоками для каждого потока выполнения.
+//
+// Xoshiro256** (Blackman, Vigna): 256 бит состояния, период 2^256 - 1, jump()
+// сдвигает состояние на 2^128 шагов, поэтому потоки, полученные прыжками от
+// одного начального состояния, гарантированно не пересекаются.
+//
+// PrintableFiller заполняет буферы печатными символами ASCII (32..126) без
+// отбраковки: 16-битное случайное число x отображается в 32 + (x * 95) >> 16
+// (неравномерность меньше 0.2%). Четыре независимых генератора идут в ногу,
+// что позволяет держать их в одном регистре AVX2; скалярная версия повторяет
+// ту же схему, и результат не зависит от набора инструкций процессора.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FAST_RANDOM_X86 1
+#endif
+
+// SplitMix64: раскрутка 64-битного зерна в состояние xoshiro
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// Генератор xoshiro256**; удовлетворяет требованиям UniformRandomBitGenerator
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t seed = 0) {
+        uint64_t sm = seed;
+        for (auto& word : s) {
+            word = splitMix64(sm);
+        }
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        uint64_t result = rotl64(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl64(s[3], 45);
+        return result;
+    }
+
+    // Равномерное число в [0, bound) без деления (Lemire), с отбраковкой редкого смещенного хвоста
+    uint32_t nextBelow(uint32_t bound) {
+        uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * bound;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < bound) {
+            uint32_t threshold = static_cast<uint32_t>(-bound) % bound;
+            while (low < threshold) {
+                m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * bound;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    // Равномерное число в [0, 1) с 53 значащими битами
+    double nextDouble() {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    // Сдвиг на 2^128 шагов: начало следующего независимого потока
+    void jump() {
+        static constexpr uint64_t jumpPoly[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                                0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        std::array<uint64_t, 4> acc{};
+        for (uint64_t poly : jumpPoly) {
+            for (int b = 0; b < 64; ++b) {
+                if (poly & (1ULL << b)) {
+                    for (int w = 0; w < 4; ++w) {
+                        acc[w] ^= s[w];
+                    }
+                }
+                (*this)();
+            }
+        }
+        s = acc;
+    }
+
+    const std::array<uint64_t, 4>& state() const {
+        return s;
+    }
+
+private:
+    std::array<uint64_t, 4> s;
+};
+
+// Раздача непересекающихся потоков: каждый вызов next() отдает текущее состояние и прыгает на 2^128
+class RandomStreams {
+public:
+    explicit RandomStreams(uint64_t seed) : base(seed) {}
+
+    Xoshiro256 next() {
+        std::lock_guard<std::mutex> lock(m);
+        Xoshiro256 stream = base;
+        base.jump();
+        return stream;
+    }
+
+    // Общий источник потоков процесса, засеянный из random_device
+    static RandomStreams& global() {
+        static RandomStreams streams((static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}());
+        return streams;
+    }
+
+private:
+    std::mutex m;
+    Xoshiro256 base;
+};
+
+// Собственный генератор вызывающего потока; разделяемого состояния нет
+inline Xoshiro256& threadRandom() {
+    thread_local Xoshiro256 generator = RandomStreams::global().next();
+    return generator;
+}
+
+// Заполнение буферов печатными символами ASCII из четырех генераторов xoshiro256**
+class PrintableFiller {
+public:
+    static constexpr size_t lanes = 4;       // Генераторов, идущих в ногу
+    static constexpr size_t blockBytes = 32; // Символов за два шага всех генераторов
+
+    // Генераторы - последовательные прыжки от source, сам source сдвигается за них
+    explicit PrintableFiller(Xoshiro256& source) {
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            Xoshiro256 stream = source;
+            source.jump();
+            for (int w = 0; w < 4; ++w) {
+                s[w][lane] = stream.state()[w];
+            }
+        }
+    }
+
+    // Заполнение с выбором реализации по возможностям процессора
+    void fill(char* out, size_t n) {
+        if (hasAvx2()) {
+            fillAvx2(out, n);
+        } else {
+            fillScalar(out, n);
+        }
+    }
+
+    void fillScalar(char* out, size_t n) {
+        size_t full = n / blockBytes * blockBytes;
+        for (size_t i = 0; i < full; i += blockBytes) {
+            scalarBlock(out + i);
+        }
+        if (full < n) {
+            char tail[blockBytes];
+            scalarBlock(tail);
+            std::memcpy(out + full, tail, n - full);
+        }
+    }
+
+#ifdef FAST_RANDOM_X86
+    __attribute__((target("avx2"))) void fillAvx2(char* out, size_t n) {
+        __m256i s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[0]));
+        __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[1]));
+        __m256i s2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[2]));
+        __m256i s3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s[3]));
+        const __m256i range = _mm256_set1_epi16(95);
+        const __m256i first = _mm256_set1_epi16(32);
+
+        size_t i = 0;
+        for (; i + blockBytes <= n; i += blockBytes) {
+            __m256i a = stepAvx2(s0, s1, s2, s3, range, first);
+            __m256i b = stepAvx2(s0, s1, s2, s3, range, first);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_packus_epi16(a, b));
+        }
+        if (i < n) {
+            __m256i a = stepAvx2(s0, s1, s2, s3, range, first);
+            __m256i b = stepAvx2(s0, s1, s2, s3, range, first);
+            alignas(32) char tail[blockBytes];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(tail), _mm256_packus_epi16(a, b));
+            std::memcpy(out + i, tail, n - i);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[0]), s0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[1]), s1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[2]), s2);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(s[3]), s3);
+    }
+
+    // Шаг четырех генераторов в регистрах AVX2; возвращает 16 печатных символов в 16-битных словах
+    __attribute__((target("avx2"))) static inline __m256i stepAvx2(__m256i& s0, __m256i& s1, __m256i& s2, __m256i& s3,
+                                                                   __m256i range, __m256i first) {
+        __m256i x = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1); // s1 * 5
+        x = _mm256_or_si256(_mm256_slli_epi64(x, 7), _mm256_srli_epi64(x, 57));
+        __m256i result = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x); // * 9
+        __m256i t = _mm256_slli_epi64(s1, 17);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+        return _mm256_add_epi16(_mm256_mulhi_epu16(result, range), first);
+    }
+
+    static bool hasAvx2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+#else
+    void fillAvx2(char* out, size_t n) {
+        fillScalar(out, n);
+    }
+
+    static bool hasAvx2() {
+        return false;
+    }
+#endif
+
+private:
+    // Один шаг всех генераторов: 64 бита с каждого
+    void scalarStep(uint64_t result[lanes]) {
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint64_t& s0 = s[0][lane];
+            uint64_t& s1 = s[1][lane];
+            uint64_t& s2 = s[2][lane];
+            uint64_t& s3 = s[3][lane];
+            result[lane] = rotl64(s1 * 5, 7) * 9;
+            uint64_t t = s1 << 17;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            s3 = rotl64(s3, 45);
+        }
+    }
+
+    // 16-битное слово с номером word из результата шага (порядок как у регистра AVX2)
+    static uint8_t printable(const uint64_t result[lanes], size_t word) {
+        uint16_t x = static_cast<uint16_t>(result[word / 4] >> (16 * (word % 4)));
+        return static_cast<uint8_t>(32 + ((static_cast<uint32_t>(x) * 95) >> 16));
+    }
+
+    // Блок из двух шагов; порядок байтов повторяет _mm256_packus_epi16 (по 128-битным половинам)
+    void scalarBlock(char* out) {
+        uint64_t a[lanes];
+        uint64_t b[lanes];
+        scalarStep(a);
+        scalarStep(b);
+        for (size_t half = 0; half < 2; ++half) {
+            for (size_t k = 0; k < 8; ++k) {
+                out[half * 16 + k] = static_cast<char>(printable(a, half * 8 + k));
+                out[half * 16 + 8 + k] = static_cast<char>(printable(b, half * 8 + k));
+            }
+        }
+    }
+
+    alignas(32) uint64_t s[4][lanes]; // s[w][lane]: слово w состояния генератора lane
+};
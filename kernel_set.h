@@ -0,0 +1,58 @@
+#pragma once
+
+// Выбор набора векторных ядер во время выполнения.
+//
+// Векторные версии горячих циклов компилируются через атрибут target, поэтому
+// программа собирается без -mavx2 и работает на любом x86-64; какое ядро
+// вызывать, решает activeKernels. По умолчанию это лучший набор, который
+// поддерживает процессор; --kernels может только понизить его (например, для
+// сравнения со скалярной версией), но не выбрать неподдерживаемый.
+//
+// На других архитектурах KERNEL_SET_X86 не определен и остается только Scalar.
+
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNEL_SET_X86 1
+#endif
+
+// Набор ядер
+enum class KernelSet {
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+// Лучший набор, поддерживаемый процессором
+inline KernelSet detectKernelSet() {
+#ifdef KERNEL_SET_X86
+    if (__builtin_cpu_supports("avx512f")) {
+        return KernelSet::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return KernelSet::Avx2;
+    }
+#endif
+    return KernelSet::Scalar;
+}
+
+// Используемый набор: по умолчанию лучший из поддерживаемых, --kernels может его понизить
+inline KernelSet activeKernels = detectKernelSet();
+
+// Разбор набора из командной строки (auto|scalar|avx2|avx512); неподдерживаемый процессором набор - ошибка
+inline bool parseKernelSet(const std::string& text, KernelSet& out) {
+    KernelSet best = detectKernelSet();
+    if (text == "auto") {
+        out = best;
+    } else if (text == "scalar") {
+        out = KernelSet::Scalar;
+    } else if (text == "avx2" && best != KernelSet::Scalar) {
+        out = KernelSet::Avx2;
+    } else if (text == "avx512" && best == KernelSet::Avx512) {
+        out = KernelSet::Avx512;
+    } else {
+        return false;
+    }
+    return true;
+}